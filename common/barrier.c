@@ -0,0 +1,236 @@
+/**
+ * Spin-then-futex barriers (see barrier.h). Build with the program that uses them:
+ *   gcc -O2 -pthread -c barrier.c
+ *
+ * Every flag a thread waits on is an int holding a sense value (0 or 1) shifted up one bit.
+ * Bit 0 is set by a waiter that has given up spinning and is about to sleep, and the thread
+ * that changes the flag swaps the whole word, so it learns from the old value whether a
+ * futex wake is needed. Outside Linux the sleep is a sched_yield.
+ *
+ * A team with more threads than online CPUs sleeps at once: the thread it would spin for
+ * may be waiting for this very core.
+ */
+
+#define _GNU_SOURCE
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "barrier.h"
+
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define CACHELINE 64
+#define MAXROUNDS 16  /* log2 of the largest team */
+#define SPINS 1000    /* polls of a flag before sleeping on it, some tens of microseconds */
+
+/* One per thread, on its own cache lines */
+struct BarrierNode {
+  int sense;                /* the value this thread's current episode waits for */
+  int parity;               /* dissemination: which set of flags this episode uses */
+  int wake;                 /* tournament: set by the thread that beat this one */
+  int arrive[MAXROUNDS];    /* tournament: set in round k by the thread this one beats */
+  int flags[2][MAXROUNDS];  /* dissemination: set in round k by the thread 2^k behind */
+} __attribute__((aligned(CACHELINE)));
+
+struct BarrierVariant {
+  const char *name;
+  void (*wait)(struct Barrier *, int);
+};
+
+struct Barrier {
+  const struct BarrierVariant *variant;
+  int nthreads;
+  int rounds;               /* ceil(log2 nthreads) */
+  int spins;                /* SPINS, or 0 when the team oversubscribes the CPUs */
+  struct BarrierNode *nodes;
+  int count __attribute__((aligned(CACHELINE)));  /* sense: threads yet to arrive */
+  int sense __attribute__((aligned(CACHELINE)));  /* sense: flipped by the last arrival */
+  pthread_mutex_t mutex;    /* condvar */
+  pthread_cond_t cond;
+  int arrived, round;
+};
+
+/* ---- flags ---- */
+
+static void cpu_relax(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_ia32_pause();
+#endif
+}
+
+static void futex_wait(int *word, int value) {
+#ifdef __linux__
+  syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+  (void) word;
+  (void) value;
+  sched_yield();
+#endif
+}
+
+static void futex_wake(int *word) {
+#ifdef __linux__
+  syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+  (void) word;
+#endif
+}
+
+static void flag_set(int *flag, int sense) {
+  if (__atomic_exchange_n(flag, sense << 1, __ATOMIC_ACQ_REL) & 1)
+    futex_wake(flag);
+}
+
+static void flag_wait(int *flag, int sense, int spins) {
+  int current;
+  for (; spins > 0; spins--) {
+    if (__atomic_load_n(flag, __ATOMIC_ACQUIRE) >> 1 == sense)
+      return;
+    cpu_relax();
+  }
+  current = __atomic_load_n(flag, __ATOMIC_ACQUIRE);
+  while (current >> 1 != sense) {
+    /* a failed exchange means the flag changed under us (or the bit is already set), and
+       reloads current; FUTEX_WAIT returns at once if the word is no longer current | 1 */
+    if ((current & 1) || __atomic_compare_exchange_n(flag, &current, current | 1, 0,
+                                                     __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      futex_wait(flag, current | 1);
+      current = __atomic_load_n(flag, __ATOMIC_ACQUIRE);
+    }
+  }
+}
+
+/* ---- variants ---- */
+
+static void wait_sense(struct Barrier *barrier, int id) {
+  struct BarrierNode *node = &barrier->nodes[id];
+  node->sense = !node->sense;
+  if (__atomic_sub_fetch(&barrier->count, 1, __ATOMIC_ACQ_REL) == 0) {
+    /* nobody touches the count again until the flag below releases them */
+    __atomic_store_n(&barrier->count, barrier->nthreads, __ATOMIC_RELAXED);
+    flag_set(&barrier->sense, node->sense);
+  } else {
+    flag_wait(&barrier->sense, node->sense, barrier->spins);
+  }
+}
+
+/* Hensgen, Finkel and Manber; alternating two sets of flags means a thread that races ahead
+   into the next episode cannot overwrite a flag its partner has yet to see */
+static void wait_dissemination(struct Barrier *barrier, int id) {
+  struct BarrierNode *node = &barrier->nodes[id];
+  int k;
+  for (k = 0; k < barrier->rounds; k++) {
+    flag_set(&barrier->nodes[(id + (1 << k)) % barrier->nthreads].flags[node->parity][k], node->sense);
+    flag_wait(&node->flags[node->parity][k], node->sense, barrier->spins);
+  }
+  if (node->parity == 1)
+    node->sense = !node->sense;
+  node->parity = 1 - node->parity;
+}
+
+/* Thread id loses in the round of its lowest set bit, to id minus that bit, and wins every
+   round before it against id plus the round's bit (if there is such a thread). Thread 0 wins
+   them all and starts the release. */
+static void wait_tournament(struct Barrier *barrier, int id) {
+  struct BarrierNode *node = &barrier->nodes[id];
+  int k;
+  for (k = 0; k < barrier->rounds; k++) {
+    if (id & (1 << k)) {
+      flag_set(&barrier->nodes[id - (1 << k)].arrive[k], node->sense);
+      flag_wait(&node->wake, node->sense, barrier->spins);
+      break;
+    }
+    if (id + (1 << k) < barrier->nthreads)
+      flag_wait(&node->arrive[k], node->sense, barrier->spins);
+  }
+  for (k--; k >= 0; k--)
+    if (id + (1 << k) < barrier->nthreads)
+      flag_set(&barrier->nodes[id + (1 << k)].wake, node->sense);
+  node->sense = !node->sense;
+}
+
+static void wait_condvar(struct Barrier *barrier, int id) {
+  int round;
+  (void) id;
+  pthread_mutex_lock(&barrier->mutex);
+  if (++barrier->arrived == barrier->nthreads) {
+    barrier->arrived = 0;
+    barrier->round++;
+    pthread_cond_broadcast(&barrier->cond);
+  } else {
+    round = barrier->round;
+    do {
+      pthread_cond_wait(&barrier->cond, &barrier->mutex);
+    } while (round == barrier->round); /* spurious wakeups */
+  }
+  pthread_mutex_unlock(&barrier->mutex);
+}
+
+static const struct BarrierVariant variants[] = {
+  {"sense", wait_sense},
+  {"dissemination", wait_dissemination},
+  {"tournament", wait_tournament},
+  {"condvar", wait_condvar},
+};
+#define NUM_VARIANTS ((int) (sizeof(variants) / sizeof(variants[0])))
+
+/* ---- interface ---- */
+
+struct Barrier *barrier_create(int nthreads, const char *variant) {
+  struct Barrier *barrier;
+  void *nodes;
+  int k;
+  if (variant == NULL)
+    variant = getenv("BARRIER");
+  if (variant == NULL)
+    variant = variants[0].name;
+  if (nthreads < 1 || nthreads > 1 << MAXROUNDS)
+    return NULL;
+  for (k = 0; k < NUM_VARIANTS && strcmp(variants[k].name, variant) != 0; k++)
+    ;
+  if (k == NUM_VARIANTS)
+    return NULL;
+  if (posix_memalign((void **) &barrier, CACHELINE, sizeof(struct Barrier)) != 0)
+    return NULL;
+  if (posix_memalign(&nodes, CACHELINE, nthreads * sizeof(struct BarrierNode)) != 0) {
+    free(barrier);
+    return NULL;
+  }
+  memset(barrier, 0, sizeof(struct Barrier));
+  memset(nodes, 0, nthreads * sizeof(struct BarrierNode));
+  barrier->variant = &variants[k];
+  barrier->nthreads = nthreads;
+  barrier->nodes = nodes;
+  for (barrier->rounds = 0; 1 << barrier->rounds < nthreads; barrier->rounds++)
+    ;
+  barrier->spins = nthreads > sysconf(_SC_NPROCESSORS_ONLN) ? 0 : SPINS;
+  barrier->count = nthreads;
+  /* all flags start at 0. The first episode waits for 1: sense flips before waiting, the
+     others after. */
+  for (k = 0; k < nthreads; k++)
+    barrier->nodes[k].sense = barrier->variant->wait != wait_sense;
+  pthread_mutex_init(&barrier->mutex, NULL);
+  pthread_cond_init(&barrier->cond, NULL);
+  return barrier;
+}
+
+void barrier_wait(struct Barrier *barrier, int id) {
+  barrier->variant->wait(barrier, id);
+}
+
+void barrier_destroy(struct Barrier *barrier) {
+  pthread_mutex_destroy(&barrier->mutex);
+  pthread_cond_destroy(&barrier->cond);
+  free(barrier->nodes);
+  free(barrier);
+}
+
+const char *barrier_variant(const struct Barrier *barrier) {
+  return barrier->variant->name;
+}
@@ -0,0 +1,40 @@
+/**
+ * Reusable barriers for a fixed team of threads, numbered 0 .. nthreads-1.
+ *
+ * A waiting thread spins on a flag for a short while and then sleeps on it with a futex, so
+ * a barrier that completes quickly costs no system calls and no lock, and one that does not
+ * leaves the core free. The thread that releases a flag only calls into the kernel when some
+ * thread has gone to sleep on it. The variants are:
+ *   sense          one shared counter and a shared sense flag that all threads wait on
+ *   dissemination  log2(n) rounds in which every thread signals the thread 2^k ahead of it;
+ *                  no shared counter, every flag has a single writer and a single reader
+ *   tournament     threads pair off in log2(n) rounds, the winners wait for the losers and the
+ *                  overall winner releases them back down the tree
+ *   condvar        the mutex and condition variable barrier, for comparison
+ * The environment variable BARRIER=<variant> picks the variant when none is given.
+ */
+
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct Barrier;
+
+/* A barrier for nthreads threads of the named variant, or of $BARRIER, or "sense" if both
+   are NULL. Returns NULL if the name is unknown or memory runs out. */
+struct Barrier *barrier_create(int nthreads, const char *variant);
+/* Returns once all nthreads threads have called it; id is the caller's number. Every write a
+   thread made before the call is visible to every thread after it. */
+void barrier_wait(struct Barrier *barrier, int id);
+void barrier_destroy(struct Barrier *barrier);
+/* Name of the variant in use */
+const char *barrier_variant(const struct Barrier *barrier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,254 @@
+/**
+ * SIMD variants of the Jacobi stencils, dispatched at startup (see stencil_kernels.h).
+ *
+ * Each variant updates whole vectors of points with unaligned loads, keeps a vector of
+ * running maxima of |new - old| and reduces it once at the end; the points left over are
+ * done by the scalar loop. Build with any -O level, no -m flags are needed:
+ *   gcc -O2 -c stencil_kernels.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "stencil_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STENCIL_X86 1
+#include <immintrin.h>
+#endif
+
+typedef float (*ring_kernel)(const float *, float *, long, long);
+typedef double (*row5_kernel)(const double *, const double *, const double *, double *, long, long);
+
+struct StencilVariant {
+  const char *name;
+  ring_kernel ring;
+  row5_kernel row5;
+};
+
+/* ---- scalar, also used for the tails of the vector loops ---- */
+
+static float ring_scalar(const float *cur, float *next, long first, long last) {
+  float maxdiff = 0.0f, diff;
+  long i;
+  for (i = first; i <= last; i++) {
+    next[i] = 0.5f * (cur[i-1] + cur[i+1]);
+    diff = next[i] - cur[i];
+    if (diff < 0)
+      diff = -diff;
+    if (maxdiff < diff)
+      maxdiff = diff;
+  }
+  return maxdiff;
+}
+
+static double row5_scalar(const double *up, const double *row, const double *down, double *next,
+                          long first, long last) {
+  double maxdiff = 0.0, diff;
+  long j;
+  for (j = first; j <= last; j++) {
+    next[j] = (up[j] + down[j] + row[j-1] + row[j+1]) * 0.25;
+    diff = next[j] - row[j];
+    if (diff < 0)
+      diff = -diff;
+    if (maxdiff < diff)
+      maxdiff = diff;
+  }
+  return maxdiff;
+}
+
+#ifdef STENCIL_X86
+
+/* ---- SSE2: 4 floats / 2 doubles ---- */
+
+__attribute__((target("sse2")))
+static float ring_sse2(const float *cur, float *next, long first, long last) {
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 vmax = _mm_setzero_ps();
+  float lanes[4], maxdiff = 0.0f, tail;
+  long i = first;
+  int k;
+  for (; i + 3 <= last; i += 4) {
+    __m128 v = _mm_mul_ps(half, _mm_add_ps(_mm_loadu_ps(&cur[i-1]), _mm_loadu_ps(&cur[i+1])));
+    _mm_storeu_ps(&next[i], v);
+    vmax = _mm_max_ps(vmax, _mm_andnot_ps(sign, _mm_sub_ps(v, _mm_loadu_ps(&cur[i]))));
+  }
+  _mm_storeu_ps(lanes, vmax);
+  for (k = 0; k < 4; k++)
+    if (maxdiff < lanes[k])
+      maxdiff = lanes[k];
+  tail = ring_scalar(cur, next, i, last);
+  return maxdiff < tail ? tail : maxdiff;
+}
+
+__attribute__((target("sse2")))
+static double row5_sse2(const double *up, const double *row, const double *down, double *next,
+                        long first, long last) {
+  const __m128d quarter = _mm_set1_pd(0.25);
+  const __m128d sign = _mm_set1_pd(-0.0);
+  __m128d vmax = _mm_setzero_pd();
+  double lanes[2], maxdiff, tail;
+  long j = first;
+  for (; j + 1 <= last; j += 2) {
+    __m128d sum = _mm_add_pd(_mm_loadu_pd(&up[j]), _mm_loadu_pd(&down[j]));
+    sum = _mm_add_pd(sum, _mm_loadu_pd(&row[j-1]));
+    sum = _mm_add_pd(sum, _mm_loadu_pd(&row[j+1]));
+    __m128d v = _mm_mul_pd(sum, quarter);
+    _mm_storeu_pd(&next[j], v);
+    vmax = _mm_max_pd(vmax, _mm_andnot_pd(sign, _mm_sub_pd(v, _mm_loadu_pd(&row[j]))));
+  }
+  _mm_storeu_pd(lanes, vmax);
+  maxdiff = lanes[0] < lanes[1] ? lanes[1] : lanes[0];
+  tail = row5_scalar(up, row, down, next, j, last);
+  return maxdiff < tail ? tail : maxdiff;
+}
+
+/* ---- AVX2: 8 floats / 4 doubles ---- */
+
+__attribute__((target("avx2")))
+static float ring_avx2(const float *cur, float *next, long first, long last) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  __m256 vmax = _mm256_setzero_ps();
+  float lanes[8], maxdiff = 0.0f, tail;
+  long i = first;
+  int k;
+  for (; i + 7 <= last; i += 8) {
+    __m256 v = _mm256_mul_ps(half, _mm256_add_ps(_mm256_loadu_ps(&cur[i-1]), _mm256_loadu_ps(&cur[i+1])));
+    _mm256_storeu_ps(&next[i], v);
+    vmax = _mm256_max_ps(vmax, _mm256_andnot_ps(sign, _mm256_sub_ps(v, _mm256_loadu_ps(&cur[i]))));
+  }
+  _mm256_storeu_ps(lanes, vmax);
+  for (k = 0; k < 8; k++)
+    if (maxdiff < lanes[k])
+      maxdiff = lanes[k];
+  tail = ring_scalar(cur, next, i, last);
+  return maxdiff < tail ? tail : maxdiff;
+}
+
+__attribute__((target("avx2")))
+static double row5_avx2(const double *up, const double *row, const double *down, double *next,
+                        long first, long last) {
+  const __m256d quarter = _mm256_set1_pd(0.25);
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d vmax = _mm256_setzero_pd();
+  double lanes[4], maxdiff = 0.0, tail;
+  long j = first;
+  int k;
+  for (; j + 3 <= last; j += 4) {
+    __m256d sum = _mm256_add_pd(_mm256_loadu_pd(&up[j]), _mm256_loadu_pd(&down[j]));
+    sum = _mm256_add_pd(sum, _mm256_loadu_pd(&row[j-1]));
+    sum = _mm256_add_pd(sum, _mm256_loadu_pd(&row[j+1]));
+    __m256d v = _mm256_mul_pd(sum, quarter);
+    _mm256_storeu_pd(&next[j], v);
+    vmax = _mm256_max_pd(vmax, _mm256_andnot_pd(sign, _mm256_sub_pd(v, _mm256_loadu_pd(&row[j]))));
+  }
+  _mm256_storeu_pd(lanes, vmax);
+  for (k = 0; k < 4; k++)
+    if (maxdiff < lanes[k])
+      maxdiff = lanes[k];
+  tail = row5_scalar(up, row, down, next, j, last);
+  return maxdiff < tail ? tail : maxdiff;
+}
+
+/* ---- AVX-512: 16 floats / 8 doubles ---- */
+
+__attribute__((target("avx512f")))
+static float ring_avx512(const float *cur, float *next, long first, long last) {
+  const __m512 half = _mm512_set1_ps(0.5f);
+  __m512 vmax = _mm512_setzero_ps();
+  float maxdiff, tail;
+  long i = first;
+  for (; i + 15 <= last; i += 16) {
+    __m512 v = _mm512_mul_ps(half, _mm512_add_ps(_mm512_loadu_ps(&cur[i-1]), _mm512_loadu_ps(&cur[i+1])));
+    _mm512_storeu_ps(&next[i], v);
+    vmax = _mm512_max_ps(vmax, _mm512_abs_ps(_mm512_sub_ps(v, _mm512_loadu_ps(&cur[i]))));
+  }
+  maxdiff = _mm512_reduce_max_ps(vmax);
+  tail = ring_scalar(cur, next, i, last);
+  return maxdiff < tail ? tail : maxdiff;
+}
+
+__attribute__((target("avx512f")))
+static double row5_avx512(const double *up, const double *row, const double *down, double *next,
+                          long first, long last) {
+  const __m512d quarter = _mm512_set1_pd(0.25);
+  __m512d vmax = _mm512_setzero_pd();
+  double maxdiff, tail;
+  long j = first;
+  for (; j + 7 <= last; j += 8) {
+    __m512d sum = _mm512_add_pd(_mm512_loadu_pd(&up[j]), _mm512_loadu_pd(&down[j]));
+    sum = _mm512_add_pd(sum, _mm512_loadu_pd(&row[j-1]));
+    sum = _mm512_add_pd(sum, _mm512_loadu_pd(&row[j+1]));
+    __m512d v = _mm512_mul_pd(sum, quarter);
+    _mm512_storeu_pd(&next[j], v);
+    vmax = _mm512_max_pd(vmax, _mm512_abs_pd(_mm512_sub_pd(v, _mm512_loadu_pd(&row[j]))));
+  }
+  maxdiff = _mm512_reduce_max_pd(vmax);
+  tail = row5_scalar(up, row, down, next, j, last);
+  return maxdiff < tail ? tail : maxdiff;
+}
+
+#endif /* STENCIL_X86 */
+
+/* Narrowest first; the widest supported one wins */
+static const struct StencilVariant variants[] = {
+  {"scalar", ring_scalar, row5_scalar},
+#ifdef STENCIL_X86
+  {"sse2", ring_sse2, row5_sse2},
+  {"avx2", ring_avx2, row5_avx2},
+  {"avx512", ring_avx512, row5_avx512},
+#endif
+};
+#define NUM_VARIANTS ((int) (sizeof(variants) / sizeof(variants[0])))
+
+static const struct StencilVariant *current = &variants[0];
+
+static int cpu_supports(const char *name) {
+#ifdef STENCIL_X86
+  __builtin_cpu_init();
+  if (strcmp(name, "sse2") == 0)
+    return __builtin_cpu_supports("sse2");
+  if (strcmp(name, "avx2") == 0)
+    return __builtin_cpu_supports("avx2");
+  if (strcmp(name, "avx512") == 0)
+    return __builtin_cpu_supports("avx512f");
+#endif
+  return strcmp(name, "scalar") == 0;
+}
+
+/* Runs before main, so the choice is made before any thread can call a kernel */
+__attribute__((constructor))
+static void stencil_select(void) {
+  const char *requested = getenv("STENCIL_ISA");
+  int k;
+  if (requested != NULL && stencil_set_isa(requested))
+    return;
+  for (k = 0; k < NUM_VARIANTS; k++)
+    if (cpu_supports(variants[k].name))
+      current = &variants[k];
+}
+
+int stencil_set_isa(const char *name) {
+  int k;
+  for (k = 0; k < NUM_VARIANTS; k++) {
+    if (strcmp(variants[k].name, name) == 0 && cpu_supports(name)) {
+      current = &variants[k];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+const char *stencil_isa(void) {
+  return current->name;
+}
+
+float stencil_ring_f32(const float *cur, float *next, long first, long last) {
+  return current->ring(cur, next, first, last);
+}
+
+double stencil_row5_f64(const double *up, const double *row, const double *down, double *next,
+                        long first, long last) {
+  return current->row5(up, row, down, next, first, last);
+}
@@ -0,0 +1,38 @@
+/**
+ * Vectorised Jacobi stencils shared by the shared-memory and MPI solvers.
+ *
+ * Every kernel writes the update and returns the largest |new - old| of the points it
+ * wrote, in the same pass, so no separate sweep is needed to check convergence. SSE2, AVX2
+ * and AVX-512 variants are built into the same object with per-function target attributes
+ * (GCC/Clang), and the widest one the CPU supports is picked at startup from CPUID. The
+ * environment variable STENCIL_ISA=scalar|sse2|avx2|avx512 picks a narrower one instead.
+ * All variants add in the same order as the scalar loop, so their results are identical.
+ */
+
+#ifndef STENCIL_KERNELS_H
+#define STENCIL_KERNELS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 1D 3-point ring: next[i] = 0.5 * (cur[i-1] + cur[i+1]) for i = first..last */
+float stencil_ring_f32(const float *cur, float *next, long first, long last);
+
+/* One row of the 2D 5-point stencil:
+   next[j] = (up[j] + down[j] + row[j-1] + row[j+1]) * 0.25 for j = first..last,
+   returning the largest |next[j] - row[j]| */
+double stencil_row5_f64(const double *up, const double *row, const double *down, double *next,
+                        long first, long last);
+
+/* Name of the variant in use: "scalar", "sse2", "avx2" or "avx512" */
+const char *stencil_isa(void);
+/* Switches to the named variant; returns 0 if the CPU lacks it or the name is unknown.
+   Call before any thread runs a kernel. */
+int stencil_set_isa(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+#include <vector>
+#include <cstring> // For std::memcpy, std::memcmp
+#include "array_io.h"
+
+MPI_Datatype slab_of_every_problem(int64_t num_points, int batch, int count);
+
+bool read_array_size(const char *path, MPI_Comm comm, MPI_Offset trailer_size, int64_t &num_points)
+{
+    MPI_File file;
+    MPI_Offset file_size;
+    char header[ARRAY_FILE_HEADER_SIZE];
+
+    if (MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
+        return false;
+    }
+    // Reads past the end of a file are not reliably reported as short (Open MPI's OMPIO
+    // counts them in full), so the file's length is checked against its header instead.
+    // Every rank sees the same length, so every rank takes the same branch.
+    bool success = MPI_File_get_size(file, &file_size) == MPI_SUCCESS &&
+                   file_size >= ARRAY_FILE_HEADER_SIZE + trailer_size;
+    // Every rank needs the size, and a collective read of the same bytes is a single
+    // file access followed by a broadcast in most MPI-IO implementations
+    if (success)
+    {
+        success = MPI_File_read_at_all(file, 0, header, ARRAY_FILE_HEADER_SIZE, MPI_BYTE,
+                                       MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    }
+    MPI_File_close(&file);
+    if (!success || std::memcmp(header, ARRAY_FILE_MAGIC, 8) != 0)
+    {
+        return false;
+    }
+
+    std::memcpy(&num_points, header + 8, sizeof(num_points));
+    MPI_Offset data_size = file_size - ARRAY_FILE_HEADER_SIZE - trailer_size;
+    return num_points > 0 && data_size % (MPI_Offset)sizeof(float) == 0 &&
+           num_points == data_size / (MPI_Offset)sizeof(float);
+}
+
+bool read_array_slab(const char *path, MPI_Comm comm, int64_t first_index, int count, float *data)
+{
+    MPI_File file;
+    MPI_Status status;
+    int received = 0;
+
+    if (MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
+        return false;
+    }
+    MPI_Offset offset = ARRAY_FILE_HEADER_SIZE + first_index * (MPI_Offset)sizeof(float);
+    bool success = MPI_File_read_at_all(file, offset, data, count, MPI_FLOAT, &status) == MPI_SUCCESS;
+    MPI_File_close(&file);
+
+    // read_array_size has checked the file's length; this only catches a short read that
+    // the MPI library does report
+    if (success)
+    {
+        MPI_Get_count(&status, MPI_FLOAT, &received);
+        success = received == count;
+    }
+    return all_ranks_succeeded(success, comm);
+}
+
+bool write_array(const char *path, MPI_Comm comm, int64_t num_points, int64_t first_index, int count, const float *data)
+{
+    MPI_File file;
+    int rank;
+    char header[ARRAY_FILE_HEADER_SIZE];
+
+    MPI_Comm_rank(comm, &rank);
+    if (MPI_File_open(comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
+        return false;
+    }
+    // Drops whatever an older, larger file had beyond the new end
+    bool success = MPI_File_set_size(file, ARRAY_FILE_HEADER_SIZE + num_points * (MPI_Offset)sizeof(float)) == MPI_SUCCESS;
+
+    // Rank 0 contributes the header, the others take part in the collective with nothing
+    std::memcpy(header, ARRAY_FILE_MAGIC, 8);
+    std::memcpy(header + 8, &num_points, sizeof(num_points));
+    success = MPI_File_write_at_all(file, 0, header, rank == 0 ? ARRAY_FILE_HEADER_SIZE : 0,
+                                    MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS && success;
+
+    MPI_Offset offset = ARRAY_FILE_HEADER_SIZE + first_index * (MPI_Offset)sizeof(float);
+    success = MPI_File_write_at_all(file, offset, data, count, MPI_FLOAT, MPI_STATUS_IGNORE) == MPI_SUCCESS && success;
+    MPI_File_close(&file);
+
+    return all_ranks_succeeded(success, comm);
+}
+
+bool read_array_batch(const char *path, MPI_Comm comm, int64_t num_points, int batch, int64_t first_index,
+                      int count, float *data)
+{
+    MPI_File file;
+    MPI_Status status;
+    int received = 0;
+    std::vector<float> by_problem((size_t)batch * count);
+
+    if (MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
+        return false;
+    }
+    // The view picks this slab out of every problem, so one collective read fetches them all
+    MPI_Datatype slabs = slab_of_every_problem(num_points, batch, count);
+    MPI_Offset offset = ARRAY_FILE_HEADER_SIZE + first_index * (MPI_Offset)sizeof(float);
+    bool success = MPI_File_set_view(file, offset, MPI_FLOAT, slabs, "native", MPI_INFO_NULL) == MPI_SUCCESS &&
+                   MPI_File_read_all(file, by_problem.data(), batch * count, MPI_FLOAT, &status) == MPI_SUCCESS;
+    MPI_File_close(&file);
+    MPI_Type_free(&slabs);
+
+    if (success)
+    {
+        MPI_Get_count(&status, MPI_FLOAT, &received);
+        success = received == batch * count;
+    }
+    for (int b = 0; b < batch; ++b)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            data[(size_t)i * batch + b] = by_problem[(size_t)b * count + i];
+        }
+    }
+    return all_ranks_succeeded(success, comm);
+}
+
+bool write_array_batch(const char *path, MPI_Comm comm, int64_t num_points, int batch, int64_t first_index,
+                       int count, const float *data)
+{
+    MPI_File file;
+    int rank;
+    char header[ARRAY_FILE_HEADER_SIZE];
+    int64_t total_points = num_points * batch;
+    std::vector<float> by_problem((size_t)batch * count);
+
+    for (int b = 0; b < batch; ++b)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            by_problem[(size_t)b * count + i] = data[(size_t)i * batch + b];
+        }
+    }
+
+    MPI_Comm_rank(comm, &rank);
+    if (MPI_File_open(comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
+        return false;
+    }
+    bool success = MPI_File_set_size(file, ARRAY_FILE_HEADER_SIZE + total_points * (MPI_Offset)sizeof(float)) == MPI_SUCCESS;
+
+    std::memcpy(header, ARRAY_FILE_MAGIC, 8);
+    std::memcpy(header + 8, &total_points, sizeof(total_points));
+    success = MPI_File_write_at_all(file, 0, header, rank == 0 ? ARRAY_FILE_HEADER_SIZE : 0,
+                                    MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS && success;
+
+    MPI_Datatype slabs = slab_of_every_problem(num_points, batch, count);
+    MPI_Offset offset = ARRAY_FILE_HEADER_SIZE + first_index * (MPI_Offset)sizeof(float);
+    success = MPI_File_set_view(file, offset, MPI_FLOAT, slabs, "native", MPI_INFO_NULL) == MPI_SUCCESS &&
+              MPI_File_write_all(file, by_problem.data(), batch * count, MPI_FLOAT, MPI_STATUS_IGNORE) == MPI_SUCCESS &&
+              success;
+    MPI_File_close(&file);
+    MPI_Type_free(&slabs);
+
+    return all_ranks_succeeded(success, comm);
+}
+
+// `count` floats from each of `batch` problems of num_points, as a file type
+MPI_Datatype slab_of_every_problem(int64_t num_points, int batch, int count)
+{
+    MPI_Datatype slabs;
+    MPI_Type_create_hvector(batch, count, (MPI_Aint)(num_points * sizeof(float)), MPI_FLOAT, &slabs);
+    MPI_Type_commit(&slabs);
+    return slabs;
+}
+
+bool all_ranks_succeeded(bool success, MPI_Comm comm)
+{
+    int local = success ? 1 : 0;
+    int global;
+    MPI_Allreduce(&local, &global, 1, MPI_INT, MPI_MIN, comm);
+    return global == 1;
+}
@@ -0,0 +1,30 @@
+#ifndef JACOBI_ARRAY_IO_H
+#define JACOBI_ARRAY_IO_H
+
+#include <cstdint> // For int64_t
+#include <mpi.h>
+
+// Array files are a 16-byte header, the magic "JACOBI01" followed by the number of points as
+// an int64_t, then the points as 32-bit floats. Both use the machine's byte order.
+#define ARRAY_FILE_MAGIC "JACOBI01"
+#define ARRAY_FILE_HEADER_SIZE 16
+
+// All functions are collective over comm and return the same verdict on every rank.
+// Number of points in the file's header. Fails unless the file is exactly the header, those
+// points and trailer_size further bytes long, so a truncated file is never read.
+bool read_array_size(const char *path, MPI_Comm comm, MPI_Offset trailer_size, int64_t &num_points);
+// Reads global points first_index..first_index+count-1 into data
+bool read_array_slab(const char *path, MPI_Comm comm, int64_t first_index, int count, float *data);
+// Writes a whole array file, each rank contributing the points first_index..first_index+count-1
+bool write_array(const char *path, MPI_Comm comm, int64_t num_points, int64_t first_index, int count, const float *data);
+// A batch of problems of num_points each is stored as one array file of batch * num_points
+// points, problem after problem. In memory a slab of a batch is interleaved, the `batch`
+// values of a point side by side, so data[i * batch + b] is point first_index + i of problem b.
+bool read_array_batch(const char *path, MPI_Comm comm, int64_t num_points, int batch, int64_t first_index,
+                      int count, float *data);
+bool write_array_batch(const char *path, MPI_Comm comm, int64_t num_points, int batch, int64_t first_index,
+                       int count, const float *data);
+// Collective AND of a per-rank success flag
+bool all_ranks_succeeded(bool success, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <vector>
+#include <cmath>     // For std::abs
+#include <algorithm> // For std::max, std::swap
+#include "batch.h"
+#include "ring_io.h"
+#include "timing.h"
+
+#define MAX_ITERATIONS 100000
+
+void do_batch_step(float *local_data, float *new_local, int size_per_process, int batch,
+                   const std::vector<unsigned char> &active, std::vector<float> &errors, HaloExchange &halo);
+void update_batch_points(const float *local_data, float *new_local, int first, int last, int batch,
+                         const unsigned char *active, float *errors);
+
+int run_batch(const SolverOptions &options, MPI_Comm comm)
+{
+    int num_of_processes;
+    int rank;
+    int orchestrator = 0;
+    int batch = options.batch;
+    int64_t arr_size = options.array_size;
+
+    MPI_Comm_size(comm, &num_of_processes);
+    MPI_Comm_rank(comm, &rank);
+
+    if (!options.input_path.empty() && !read_ring_size(options.input_path, batch, comm, arr_size))
+    {
+        return 1;
+    }
+    if (rank == orchestrator)
+    {
+        std::cout << "Problem size: " << arr_size << ", batch of " << batch << std::endl;
+        std::cout << "Number of processes: " << num_of_processes << std::endl;
+        std::cout << "Halo exchange: " << halo_mode_name(options.halo_mode) << std::endl;
+    }
+
+    std::vector<int64_t> counts, displs;
+    if (!partition_ring(options, arr_size, 1, batch, comm, counts, displs))
+    {
+        return 1;
+    }
+
+    int size_per_process = (int)counts[rank];
+    std::vector<float> local((size_t)(size_per_process + 2) * batch);
+    std::vector<float> new_local((size_t)(size_per_process + 2) * batch);
+    if (!load_ring_slab(options.input_path, arr_size, batch, displs[rank], size_per_process, &local[batch], comm))
+    {
+        return 1;
+    }
+
+    HaloExchange halo;
+    halo_init(halo, options.halo_mode, 1, batch, (rank + num_of_processes - 1) % num_of_processes,
+              (rank + 1) % num_of_processes, comm);
+    PhaseTimes times;
+    phase_times_init(times);
+    PhaseTimes *timer = options.timings_path.empty() ? nullptr : &times;
+    halo.times = timer;
+
+    // A problem stops being updated at the iteration its own error reaches the
+    // threshold, so it ends up exactly where solving it alone would leave it
+    float acceptable_error = 0.001f;
+    std::vector<unsigned char> active(batch, 1);
+    std::vector<float> local_errors(batch), global_errors(batch);
+    std::vector<int> problem_iterations(batch, 0);
+    std::vector<float> final_errors(batch, 0.0f);
+    int remaining = batch;
+    int iterations = 0;
+    double solve_start = phase_clock(timer);
+    while (remaining > 0)
+    {
+        do_batch_step(local.data(), new_local.data(), size_per_process, batch, active, local_errors, halo);
+        std::swap(local, new_local);
+        iterations++;
+
+        // The errors of all problems travel in one reduction
+        double reduce_start = phase_clock(timer);
+        MPI_Allreduce(local_errors.data(), global_errors.data(), batch, MPI_FLOAT, MPI_MAX, comm);
+        phase_add(timer, PHASE_REDUCE, reduce_start);
+        for (int b = 0; b < batch; ++b)
+        {
+            if (active[b])
+            {
+                problem_iterations[b] = iterations;
+                final_errors[b] = global_errors[b];
+                if (global_errors[b] <= acceptable_error)
+                {
+                    active[b] = 0;
+                    remaining--;
+                }
+            }
+        }
+        // Checked after the errors are recorded, so they describe the last sweep applied, as
+        // in solve_jacobi
+        if (iterations > MAX_ITERATIONS)
+        {
+            break;
+        }
+    }
+    if (timer)
+    {
+        times.solve_seconds = MPI_Wtime() - solve_start;
+        times.iterations = iterations;
+    }
+
+    if (rank == orchestrator)
+    {
+        if (remaining > 0)
+        {
+            std::cout << "Warning: Exceeded max iterations with " << remaining << " of " << batch
+                      << " problems unconverged" << std::endl;
+        }
+        std::cout << "Converged after " << *std::min_element(problem_iterations.begin(), problem_iterations.end())
+                  << " to " << *std::max_element(problem_iterations.begin(), problem_iterations.end())
+                  << " iterations with final error up to "
+                  << *std::max_element(final_errors.begin(), final_errors.end()) << std::endl;
+        for (int b = 0; b < batch; ++b)
+        {
+            std::cout << "Problem " << b << ": " << problem_iterations[b] << " iterations, final error "
+                      << final_errors[b] << std::endl;
+        }
+    }
+
+    int exit_code = report_ring_results(options, "jacobi", timer, arr_size, batch, counts, displs, &local[batch],
+                                        comm);
+    halo_free(halo);
+    return exit_code;
+}
+
+// One Jacobi step of every problem, with the interior updated while the ghost points are in
+// flight as in do_one_step. errors receives each problem's largest change on this rank.
+void do_batch_step(float *local_data, float *new_local, int size_per_process, int batch,
+                   const std::vector<unsigned char> &active, std::vector<float> &errors, HaloExchange &halo)
+{
+    std::fill(errors.begin(), errors.end(), 0.0f);
+    halo_start(halo, local_data, size_per_process);
+    update_batch_points(local_data, new_local, 2, size_per_process - 1, batch, active.data(), errors.data());
+    halo_finish(halo);
+    update_batch_points(local_data, new_local, 1, 1, batch, active.data(), errors.data());
+    if (size_per_process > 1)
+    {
+        update_batch_points(local_data, new_local, size_per_process, size_per_process, batch, active.data(),
+                            errors.data());
+    }
+}
+
+// Points first..last of every problem. The inner loop runs over the problems, whose values
+// are contiguous and independent, so the compiler can vectorise it. Converged problems are
+// copied unchanged.
+void update_batch_points(const float *local_data, float *new_local, int first, int last, int batch,
+                         const unsigned char *active, float *errors)
+{
+    for (int i = first; i <= last; ++i)
+    {
+        const float *left = &local_data[(size_t)(i - 1) * batch];
+        const float *centre = &local_data[(size_t)i * batch];
+        const float *right = &local_data[(size_t)(i + 1) * batch];
+        float *updated = &new_local[(size_t)i * batch];
+        for (int b = 0; b < batch; ++b)
+        {
+            float value = active[b] ? 0.5f * (left[b] + right[b]) : centre[b];
+            updated[b] = value;
+            errors[b] = std::max(errors[b], std::abs(value - centre[b]));
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef JACOBI_BATCH_H
+#define JACOBI_BATCH_H
+
+#include <mpi.h>
+#include "jacobi.h"
+
+// Solves options.batch independent rings of options.array_size points with Jacobi steps, all
+// with the same decomposition over comm. Slabs are interleaved, point i of problem b at
+// [i * batch + b], so one halo message carries a boundary point of every problem and one
+// vector reduction checks them all. Returns the process exit code.
+int run_batch(const SolverOptions &options, MPI_Comm comm);
+
+#endif
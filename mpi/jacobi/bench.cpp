@@ -0,0 +1,264 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm> // For std::swap
+#include <cstring>   // For std::strcmp, std::strncmp
+#include <cstdlib>   // For std::strtoll
+#include <climits>   // For INT_MAX
+#include <cstdint>   // For int64_t
+#include <mpi.h>
+#include "halo.h"
+#include "step.h"
+#include "thread_team.h"
+#include "decomposition.h"
+
+// A Jacobi step reads every point once and writes it once; ghost cells and the write-allocate
+// traffic of caches are not counted, so the bandwidth reported is a lower bound
+#define BYTES_PER_POINT (2 * sizeof(float))
+
+struct BenchOptions
+{
+    std::vector<int64_t> sizes;  // points in the ring, or per process when weak
+    std::vector<int64_t> iterations;
+    HaloMode halo_mode;
+    bool weak;                   // weak scaling: the ring grows with the number of processes
+    std::string output_path;     // CSV file, empty for standard output
+};
+
+bool parse_bench_options(int argc, char *argv[], BenchOptions &options);
+bool parse_list(const char *value, std::vector<int64_t> &list);
+void print_bench_usage(const char *program);
+double time_iterations(int64_t num_points, int iterations, HaloMode mode, MPI_Comm comm);
+
+// Times fixed numbers of Jacobi iterations of the ring for every size given, first on all
+// processes and then on rank 0 alone, and writes one CSV row per (size, iterations) pair.
+int main(int argc, char *argv[])
+{
+    int num_of_processes;
+    int rank;
+    int orchestrator = 0;
+    BenchOptions options;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_of_processes);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (!parse_bench_options(argc, argv, options))
+    {
+        if (rank == orchestrator)
+        {
+            print_bench_usage(argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    std::ofstream file;
+    int opened = 1;
+    if (rank == orchestrator && !options.output_path.empty())
+    {
+        file.open(options.output_path.c_str());
+        opened = file.is_open() ? 1 : 0;
+    }
+    MPI_Bcast(&opened, 1, MPI_INT, orchestrator, MPI_COMM_WORLD);
+    if (!opened)
+    {
+        if (rank == orchestrator)
+        {
+            std::cerr << "Cannot write " << options.output_path << std::endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    std::ostream &out = file.is_open() ? file : std::cout;
+    if (rank == orchestrator)
+    {
+        out << "scaling,processes,points,iterations,halo,seconds,seconds_per_iteration,"
+            << "bandwidth_gb_per_s,single_rank_seconds_per_iteration,efficiency" << std::endl;
+    }
+
+    for (size_t s = 0; s < options.sizes.size(); ++s)
+    {
+        int64_t single_points = options.sizes[s];
+        int64_t points = options.weak ? single_points * num_of_processes : single_points;
+        for (size_t i = 0; i < options.iterations.size(); ++i)
+        {
+            int iterations = (int)options.iterations[i];
+            double seconds = time_iterations(points, iterations, options.halo_mode, MPI_COMM_WORLD);
+            // The baseline runs on rank 0 alone; the others wait for it at the broadcast
+            double single_seconds = 0.0;
+            if (rank == orchestrator)
+            {
+                single_seconds = time_iterations(single_points, iterations, options.halo_mode, MPI_COMM_SELF);
+            }
+            MPI_Bcast(&single_seconds, 1, MPI_DOUBLE, orchestrator, MPI_COMM_WORLD);
+
+            if (rank == orchestrator)
+            {
+                if (seconds < 0.0 || single_seconds < 0.0)
+                {
+                    std::cerr << "Skipping " << points << " points: too small or too large for "
+                              << num_of_processes << " processes" << std::endl;
+                    continue;
+                }
+                double per_iteration = seconds / iterations;
+                double single_per_iteration = single_seconds / iterations;
+                // Strong scaling ideally divides the time by the number of processes, weak
+                // scaling ideally keeps it constant
+                double efficiency = options.weak ? single_per_iteration / per_iteration
+                                                 : single_per_iteration / (per_iteration * num_of_processes);
+                out << (options.weak ? "weak" : "strong") << "," << num_of_processes << "," << points << ","
+                    << iterations << "," << halo_mode_name(options.halo_mode) << "," << seconds << ","
+                    << per_iteration << "," << (double)points * BYTES_PER_POINT / per_iteration / 1e9 << ","
+                    << single_per_iteration << "," << efficiency << std::endl;
+            }
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
+
+// Runs `iterations` Jacobi steps of a ring of num_points split evenly over comm, each with a
+// halo exchange and an error reduction as in the solver, and returns the wall time of the
+// slowest rank. Returns -1 if the ring cannot be split over comm.
+double time_iterations(int64_t num_points, int iterations, HaloMode mode, MPI_Comm comm)
+{
+    int num_of_processes;
+    int rank;
+    MPI_Comm_size(comm, &num_of_processes);
+    MPI_Comm_rank(comm, &rank);
+
+    std::vector<int64_t> counts, displs;
+    if (!partition_array(num_points, num_of_processes, std::vector<double>(), 1, counts, displs) ||
+        counts[0] > INT_MAX - 2)
+    {
+        return -1.0;
+    }
+    int size_per_process = (int)counts[rank];
+    std::vector<float> local(size_per_process + 2);
+    std::vector<float> new_local(size_per_process + 2);
+    for (int i = 0; i < size_per_process; ++i)
+    {
+        local[i + 1] = (float)(displs[rank] + i) * 20.0f;
+    }
+
+    HaloExchange halo;
+    halo_init(halo, mode, 1, 1, (rank + num_of_processes - 1) % num_of_processes, (rank + 1) % num_of_processes, comm);
+    ThreadTeam team;
+    team_start(team, 1);
+    float local_error, global_error;
+
+    // One untimed step faults the pages in and sets up persistent requests or windows
+    do_one_step(local.data(), new_local.data(), &local_error, size_per_process, halo, team);
+    std::swap(local, new_local);
+
+    MPI_Barrier(comm);
+    double start = MPI_Wtime();
+    for (int i = 0; i < iterations; ++i)
+    {
+        do_one_step(local.data(), new_local.data(), &local_error, size_per_process, halo, team);
+        std::swap(local, new_local);
+        MPI_Allreduce(&local_error, &global_error, 1, MPI_FLOAT, MPI_MAX, comm);
+    }
+    double elapsed = MPI_Wtime() - start;
+    double slowest;
+    MPI_Allreduce(&elapsed, &slowest, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+    team_stop(team);
+    halo_free(halo);
+    return slowest;
+}
+
+bool parse_bench_options(int argc, char *argv[], BenchOptions &options)
+{
+    options.halo_mode = HALO_BLOCKING;
+    options.weak = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (std::strncmp(arg, "--sizes=", 8) == 0)
+        {
+            if (!parse_list(arg + 8, options.sizes))
+            {
+                return false;
+            }
+        }
+        else if (std::strncmp(arg, "--iterations=", 13) == 0)
+        {
+            if (!parse_list(arg + 13, options.iterations))
+            {
+                return false;
+            }
+        }
+        else if (std::strncmp(arg, "--halo=", 7) == 0)
+        {
+            if (!parse_halo_mode(arg + 7, options.halo_mode))
+            {
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--weak") == 0)
+        {
+            options.weak = true;
+        }
+        else if (std::strncmp(arg, "--output=", 9) == 0)
+        {
+            options.output_path = arg + 9;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (options.sizes.empty())
+    {
+        options.sizes = {10000, 1000000, 10000000};
+    }
+    if (options.iterations.empty())
+    {
+        options.iterations = {100, 1000};
+    }
+    for (size_t i = 0; i < options.iterations.size(); ++i)
+    {
+        if (options.iterations[i] > INT_MAX)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Comma-separated positive integers
+bool parse_list(const char *value, std::vector<int64_t> &list)
+{
+    char *end;
+    list.clear();
+    while (true)
+    {
+        long long number = std::strtoll(value, &end, 10);
+        if (end == value || number < 1)
+        {
+            return false;
+        }
+        list.push_back((int64_t)number);
+        if (*end != ',')
+        {
+            break;
+        }
+        value = end + 1;
+    }
+    return *end == '\0';
+}
+
+void print_bench_usage(const char *program)
+{
+    std::cerr << "Usage: mpirun -np <processes> " << program << " [options]" << std::endl;
+    std::cerr << "  --sizes=N1,N2,...            ring sizes to time (default 10000,1000000,10000000)" << std::endl;
+    std::cerr << "  --iterations=I1,I2,...       iteration counts to time at every size (default 100,1000)" << std::endl;
+    std::cerr << "  --weak                       sizes are per process (weak scaling) instead of in total" << std::endl;
+    std::cerr << "  --halo=MODE                  ghost cell exchange, as for jacobi (default blocking)" << std::endl;
+    std::cerr << "  --output=FILE                write the CSV to FILE instead of standard output" << std::endl;
+}
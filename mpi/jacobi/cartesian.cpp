@@ -0,0 +1,445 @@
+#include <iostream>
+#include <vector>
+#include <cmath>     // For std::abs
+#include <algorithm> // For std::max, std::min, std::swap
+#include <cstdint>   // For int64_t
+#include "cartesian.h"
+#include "convergence.h"
+
+// One process's block of a 2D/3D grid. Unused dimensions have one point and no ghost layer,
+// so 2D grids use the same indexing as 3D ones.
+struct CartesianBlock
+{
+    int ndims;
+    int local_size[MAX_GRID_DIMS]; // interior points per dimension
+    int ghost[MAX_GRID_DIMS];      // ghost layer width per dimension (0 or 1)
+    int extent[MAX_GRID_DIMS];     // allocated points per dimension
+    long stride[MAX_GRID_DIMS];    // distance in floats between neighbours along a dimension
+    int neighbour_low[MAX_GRID_DIMS];
+    int neighbour_high[MAX_GRID_DIMS];
+    MPI_Datatype face[MAX_GRID_DIMS]; // one layer perpendicular to a dimension, ghosts excluded
+    MPI_Request requests[4 * MAX_GRID_DIMS];
+    // Persistent requests for each of the two grids the solver alternates between
+    float *persistent_grid[2];
+    MPI_Request persistent[2][4 * MAX_GRID_DIMS];
+    int active;
+};
+
+// Tag of the messages that gather the solved blocks, apart from the face tags 0..2 * ndims - 1
+#define GATHER_TAG (2 * MAX_GRID_DIMS)
+
+void block_range(int n, int parts, int coord, int &first, int &size);
+void setup_block(CartesianBlock &block, const SolverOptions &options, MPI_Comm cart_comm, const int dims[]);
+void exchange_faces_start(CartesianBlock &block, float *grid, HaloMode mode, MPI_Comm cart_comm);
+void exchange_faces_finish(CartesianBlock &block, HaloMode mode);
+void start_persistent_faces(CartesianBlock &block, float *grid, MPI_Comm cart_comm);
+float update_box(const CartesianBlock &block, const float *grid, float *new_grid, const int lo[], const int hi[]);
+float do_one_grid_step(CartesianBlock &block, float *grid, float *new_grid, HaloMode mode, MPI_Comm cart_comm);
+void print_grid(const CartesianBlock &block, const SolverOptions &options, const int dims[], const float *grid,
+                MPI_Comm cart_comm);
+
+int run_cartesian(const SolverOptions &options, MPI_Comm comm)
+{
+    int num_of_processes;
+    int rank;
+    int orchestrator = 0;
+    int ndims = options.grid_dims;
+    int dims[MAX_GRID_DIMS] = {0, 0, 0};
+    int periods[MAX_GRID_DIMS] = {0, 0, 0}; // fixed boundary values on every side of the grid
+    MPI_Comm cart_comm;
+
+    MPI_Comm_size(comm, &num_of_processes);
+
+    // Let MPI pick the most square process grid, which minimises the surface-to-volume ratio
+    MPI_Dims_create(num_of_processes, ndims, dims);
+    MPI_Cart_create(comm, ndims, dims, periods, 1, &cart_comm);
+    MPI_Comm_rank(cart_comm, &rank);
+
+    for (int d = 0; d < ndims; ++d)
+    {
+        if (options.grid_size[d] < dims[d])
+        {
+            if (rank == orchestrator)
+            {
+                std::cerr << "Error: grid dimension " << d << " has " << options.grid_size[d]
+                          << " points but " << dims[d] << " processes. Exiting." << std::endl;
+            }
+            MPI_Comm_free(&cart_comm);
+            return 1;
+        }
+    }
+
+    if (rank == orchestrator)
+    {
+        std::cout << "Grid size: ";
+        for (int d = 0; d < ndims; ++d)
+        {
+            std::cout << options.grid_size[d] << (d == ndims - 1 ? "" : " x ");
+        }
+        std::cout << std::endl;
+        std::cout << "Process grid: ";
+        for (int d = 0; d < ndims; ++d)
+        {
+            std::cout << dims[d] << (d == ndims - 1 ? "" : " x ");
+        }
+        std::cout << std::endl;
+        std::cout << "Halo exchange: " << halo_mode_name(options.halo_mode) << std::endl;
+    }
+
+    CartesianBlock block;
+    setup_block(block, options, cart_comm, dims);
+
+    // Boundary ghost cells hold 1.0 and interior points start at 0.0, as in the shared-memory
+    // version. Receives from MPI_PROC_NULL leave the boundary ghost cells untouched.
+    size_t total = (size_t)block.extent[0] * block.extent[1] * block.extent[2];
+    std::vector<float> grid(total, 1.0f);
+    std::vector<float> new_grid(total, 1.0f);
+    int lo[MAX_GRID_DIMS], hi[MAX_GRID_DIMS];
+    for (int d = 0; d < MAX_GRID_DIMS; ++d)
+    {
+        lo[d] = block.ghost[d];
+        hi[d] = block.ghost[d] + block.local_size[d] - 1;
+    }
+    for (int i = lo[0]; i <= hi[0]; ++i)
+        for (int j = lo[1]; j <= hi[1]; ++j)
+            for (int k = lo[2]; k <= hi[2]; ++k)
+                grid[i * block.stride[0] + j * block.stride[1] + k] = 0.0f;
+
+    float acceptable_error = 0.001f;
+    float local_error;
+    int iterations = 0;
+    ConvergenceCheck check;
+    convergence_init(check, options.check_interval, options.async_check, acceptable_error, cart_comm);
+
+    do
+    {
+        local_error = do_one_grid_step(block, grid.data(), new_grid.data(), options.halo_mode, cart_comm);
+        // The ghost layers of new_grid are refreshed by the next exchange, so swapping is enough
+        std::swap(grid, new_grid);
+
+        iterations++;
+        if (iterations > 100000)
+        {
+            convergence_finish(check);
+            if (rank == orchestrator)
+            {
+                std::cout << "Warning: Exceeded max iterations. Error: " << check.global_error << std::endl;
+            }
+            break;
+        }
+    } while (!convergence_record(check, iterations, local_error));
+
+    if (rank == orchestrator)
+    {
+        std::cout << "Converged after " << iterations << " iterations with final error: " << check.global_error << std::endl;
+        report_extra_iterations(check, iterations);
+    }
+    print_grid(block, options, dims, grid.data(), cart_comm);
+
+    for (int g = 0; g < 2; ++g)
+    {
+        if (block.persistent_grid[g] != nullptr)
+        {
+            for (int i = 0; i < 4 * ndims; ++i)
+            {
+                MPI_Request_free(&block.persistent[g][i]);
+            }
+        }
+    }
+    for (int d = 0; d < ndims; ++d)
+    {
+        MPI_Type_free(&block.face[d]);
+    }
+    MPI_Comm_free(&cart_comm);
+    return 0;
+}
+
+// First point and number of points along a dimension of n points of the block at coordinate
+// coord of parts. The remainder is spread over the first processes.
+void block_range(int n, int parts, int coord, int &first, int &size)
+{
+    size = n / parts + (coord < n % parts ? 1 : 0);
+    first = coord * (n / parts) + std::min(coord, n % parts);
+}
+
+// Sizes the local block from this rank's Cartesian coordinates and builds the face datatypes
+void setup_block(CartesianBlock &block, const SolverOptions &options, MPI_Comm cart_comm, const int dims[])
+{
+    int rank;
+    int coords[MAX_GRID_DIMS] = {0, 0, 0};
+    MPI_Comm_rank(cart_comm, &rank);
+    MPI_Cart_coords(cart_comm, rank, options.grid_dims, coords);
+
+    block.ndims = options.grid_dims;
+    for (int d = 0; d < MAX_GRID_DIMS; ++d)
+    {
+        if (d < block.ndims)
+        {
+            int first;
+            block_range(options.grid_size[d], dims[d], coords[d], first, block.local_size[d]);
+            block.ghost[d] = 1;
+            MPI_Cart_shift(cart_comm, d, 1, &block.neighbour_low[d], &block.neighbour_high[d]);
+        }
+        else
+        {
+            block.local_size[d] = 1;
+            block.ghost[d] = 0;
+            block.neighbour_low[d] = MPI_PROC_NULL;
+            block.neighbour_high[d] = MPI_PROC_NULL;
+        }
+        block.extent[d] = block.local_size[d] + 2 * block.ghost[d];
+    }
+    block.stride[2] = 1;
+    block.stride[1] = block.extent[2];
+    block.stride[0] = (long)block.extent[1] * block.extent[2];
+
+    // A face is one layer thick along d and spans the interior of the other dimensions.
+    // Its extent is the whole block, so layer L of dimension d starts at grid + L * stride[d].
+    for (int d = 0; d < block.ndims; ++d)
+    {
+        int sizes[MAX_GRID_DIMS], subsizes[MAX_GRID_DIMS], starts[MAX_GRID_DIMS];
+        for (int e = 0; e < block.ndims; ++e)
+        {
+            sizes[e] = block.extent[e];
+            subsizes[e] = (e == d) ? 1 : block.local_size[e];
+            starts[e] = (e == d) ? 0 : block.ghost[e];
+        }
+        MPI_Type_create_subarray(block.ndims, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &block.face[d]);
+        MPI_Type_commit(&block.face[d]);
+    }
+
+    for (int i = 0; i < 4 * MAX_GRID_DIMS; ++i)
+    {
+        block.requests[i] = MPI_REQUEST_NULL;
+    }
+    block.persistent_grid[0] = nullptr;
+    block.persistent_grid[1] = nullptr;
+    block.active = 0;
+}
+
+void exchange_faces_start(CartesianBlock &block, float *grid, HaloMode mode, MPI_Comm cart_comm)
+{
+    if (mode == HALO_PERSISTENT)
+    {
+        start_persistent_faces(block, grid, cart_comm);
+        return;
+    }
+    for (int d = 0; d < block.ndims; ++d)
+    {
+        long s = block.stride[d];
+        int n = block.local_size[d];
+        int to_low = 2 * d;
+        int to_high = 2 * d + 1;
+
+        if (mode == HALO_BLOCKING)
+        {
+            // Send my first layer down, receive the upper neighbour's first layer into my upper ghost layer
+            MPI_Sendrecv(grid + s, 1, block.face[d], block.neighbour_low[d], to_low,
+                         grid + (n + 1) * s, 1, block.face[d], block.neighbour_high[d], to_low,
+                         cart_comm, MPI_STATUS_IGNORE);
+            // Send my last layer up, receive the lower neighbour's last layer into my lower ghost layer
+            MPI_Sendrecv(grid + n * s, 1, block.face[d], block.neighbour_high[d], to_high,
+                         grid, 1, block.face[d], block.neighbour_low[d], to_high,
+                         cart_comm, MPI_STATUS_IGNORE);
+        }
+        else
+        {
+            MPI_Request *requests = &block.requests[4 * d];
+            MPI_Irecv(grid + (n + 1) * s, 1, block.face[d], block.neighbour_high[d], to_low, cart_comm, &requests[0]);
+            MPI_Irecv(grid, 1, block.face[d], block.neighbour_low[d], to_high, cart_comm, &requests[1]);
+            MPI_Isend(grid + s, 1, block.face[d], block.neighbour_low[d], to_low, cart_comm, &requests[2]);
+            MPI_Isend(grid + n * s, 1, block.face[d], block.neighbour_high[d], to_high, cart_comm, &requests[3]);
+        }
+    }
+}
+
+void exchange_faces_finish(CartesianBlock &block, HaloMode mode)
+{
+    if (mode == HALO_NONBLOCKING)
+    {
+        MPI_Waitall(4 * block.ndims, block.requests, MPI_STATUSES_IGNORE);
+    }
+    else if (mode == HALO_PERSISTENT)
+    {
+        MPI_Waitall(4 * block.ndims, block.persistent[block.active], MPI_STATUSES_IGNORE);
+    }
+}
+
+// The same messages as the nonblocking exchange, set up the first time each grid is exchanged
+// and restarted with MPI_Startall from then on
+void start_persistent_faces(CartesianBlock &block, float *grid, MPI_Comm cart_comm)
+{
+    int g = (block.persistent_grid[0] == grid || block.persistent_grid[0] == nullptr) ? 0 : 1;
+    if (block.persistent_grid[g] != grid)
+    {
+        block.persistent_grid[g] = grid;
+        for (int d = 0; d < block.ndims; ++d)
+        {
+            long s = block.stride[d];
+            int n = block.local_size[d];
+            MPI_Request *requests = &block.persistent[g][4 * d];
+            MPI_Recv_init(grid + (n + 1) * s, 1, block.face[d], block.neighbour_high[d], 2 * d, cart_comm, &requests[0]);
+            MPI_Recv_init(grid, 1, block.face[d], block.neighbour_low[d], 2 * d + 1, cart_comm, &requests[1]);
+            MPI_Send_init(grid + s, 1, block.face[d], block.neighbour_low[d], 2 * d, cart_comm, &requests[2]);
+            MPI_Send_init(grid + n * s, 1, block.face[d], block.neighbour_high[d], 2 * d + 1, cart_comm, &requests[3]);
+        }
+    }
+    block.active = g;
+    MPI_Startall(4 * block.ndims, block.persistent[g]);
+}
+
+// Jacobi update of the box lo..hi (inclusive, allocated indices); returns the largest change
+float update_box(const CartesianBlock &block, const float *grid, float *new_grid, const int lo[], const int hi[])
+{
+    float max_error = 0.0f;
+    float weight = 1.0f / (2 * block.ndims);
+    long s0 = block.stride[0];
+    long s1 = block.stride[1];
+
+    for (int i = lo[0]; i <= hi[0]; ++i)
+    {
+        for (int j = lo[1]; j <= hi[1]; ++j)
+        {
+            for (int k = lo[2]; k <= hi[2]; ++k)
+            {
+                long idx = i * s0 + j * s1 + k;
+                float sum = grid[idx - s0] + grid[idx + s0] + grid[idx - s1] + grid[idx + s1];
+                if (block.ndims == 3)
+                {
+                    sum += grid[idx - 1] + grid[idx + 1];
+                }
+                new_grid[idx] = sum * weight;
+                max_error = std::max(max_error, std::abs(new_grid[idx] - grid[idx]));
+            }
+        }
+    }
+    return max_error;
+}
+
+// Exchanges the faces and updates the block. Points at least two layers away from every face
+// do not read ghost cells, so they are updated while the faces are in flight; the remaining
+// shell is split into one pair of layers per dimension, each covering points not yet updated.
+float do_one_grid_step(CartesianBlock &block, float *grid, float *new_grid, HaloMode mode, MPI_Comm cart_comm)
+{
+    int lo[MAX_GRID_DIMS], hi[MAX_GRID_DIMS];
+    float max_error;
+
+    exchange_faces_start(block, grid, mode, cart_comm);
+
+    for (int d = 0; d < MAX_GRID_DIMS; ++d)
+    {
+        lo[d] = block.ghost[d] ? 2 : 0;
+        hi[d] = block.ghost[d] ? block.local_size[d] - 1 : 0;
+    }
+    max_error = update_box(block, grid, new_grid, lo, hi);
+
+    exchange_faces_finish(block, mode);
+
+    for (int d = 0; d < block.ndims; ++d)
+    {
+        int n = block.local_size[d];
+        int layers[2] = {1, n};
+        for (int e = 0; e < MAX_GRID_DIMS; ++e)
+        {
+            // Dimensions before d keep their inner range, those after span all interior points
+            lo[e] = block.ghost[e] ? (e < d ? 2 : 1) : 0;
+            hi[e] = block.ghost[e] ? (e < d ? block.local_size[e] - 1 : block.local_size[e]) : 0;
+        }
+        for (int l = 0; l < (n > 1 ? 2 : 1); ++l)
+        {
+            lo[d] = hi[d] = layers[l];
+            max_error = std::max(max_error, update_box(block, grid, new_grid, lo, hi));
+        }
+    }
+    return max_error;
+}
+
+// Gathers the interiors of all blocks into the whole grid on rank 0 and prints it in the
+// layout of shared-memory/jacobi's results file: one line per row of the last dimension, and
+// a blank line between the planes of a 3D grid. Larger grids are only summarised.
+void print_grid(const CartesianBlock &block, const SolverOptions &options, const int dims[], const float *grid,
+                MPI_Comm cart_comm)
+{
+    int num_of_processes;
+    int rank;
+    int orchestrator = 0;
+    int ndims = block.ndims;
+    int64_t total = 1;
+    MPI_Comm_size(cart_comm, &num_of_processes);
+    MPI_Comm_rank(cart_comm, &rank);
+
+    for (int d = 0; d < ndims; ++d)
+    {
+        total *= options.grid_size[d];
+    }
+    if (total > MAX_PRINTED_POINTS)
+    {
+        if (rank == orchestrator)
+        {
+            std::cout << "Final Results: not printed for more than " << MAX_PRINTED_POINTS << " points" << std::endl;
+        }
+        return;
+    }
+
+    // Subarray types pick the interior out of the block on the sending side and place it in
+    // the whole grid on the receiving side, so nothing is packed by hand
+    int sizes[MAX_GRID_DIMS], subsizes[MAX_GRID_DIMS], starts[MAX_GRID_DIMS];
+    for (int d = 0; d < ndims; ++d)
+    {
+        sizes[d] = block.extent[d];
+        subsizes[d] = block.local_size[d];
+        starts[d] = block.ghost[d];
+    }
+    MPI_Datatype interior;
+    MPI_Type_create_subarray(ndims, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &interior);
+    MPI_Type_commit(&interior);
+    if (rank != orchestrator)
+    {
+        MPI_Send(grid, 1, interior, orchestrator, GATHER_TAG, cart_comm);
+        MPI_Type_free(&interior);
+        return;
+    }
+
+    std::vector<float> work(total);
+    for (int p = 0; p < num_of_processes; ++p)
+    {
+        int coords[MAX_GRID_DIMS];
+        MPI_Cart_coords(cart_comm, p, ndims, coords);
+        for (int d = 0; d < ndims; ++d)
+        {
+            sizes[d] = options.grid_size[d];
+            block_range(options.grid_size[d], dims[d], coords[d], starts[d], subsizes[d]);
+        }
+        MPI_Datatype placed;
+        MPI_Type_create_subarray(ndims, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &placed);
+        MPI_Type_commit(&placed);
+        if (p == orchestrator)
+        {
+            MPI_Sendrecv(grid, 1, interior, p, GATHER_TAG, work.data(), 1, placed, p, GATHER_TAG,
+                         cart_comm, MPI_STATUS_IGNORE);
+        }
+        else
+        {
+            MPI_Recv(work.data(), 1, placed, p, GATHER_TAG, cart_comm, MPI_STATUS_IGNORE);
+        }
+        MPI_Type_free(&placed);
+    }
+    MPI_Type_free(&interior);
+
+    int64_t row = options.grid_size[ndims - 1];
+    int64_t plane = row * options.grid_size[ndims - 2];
+    std::cout << "Final Results:" << std::endl;
+    for (int64_t i = 0; i < total; ++i)
+    {
+        if (i % row != row - 1)
+        {
+            std::cout << work[i] << " ";
+            continue;
+        }
+        std::cout << work[i] << std::endl;
+        if (ndims == 3 && i % plane == plane - 1 && i != total - 1)
+        {
+            std::cout << std::endl;
+        }
+    }
+}
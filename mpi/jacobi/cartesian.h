@@ -0,0 +1,11 @@
+#ifndef JACOBI_CARTESIAN_H
+#define JACOBI_CARTESIAN_H
+
+#include <mpi.h>
+#include "jacobi.h"
+
+// Solves the 2D/3D grid problem described by options.grid_dims/grid_size on a Cartesian
+// process grid built from comm. Returns the process exit code.
+int run_cartesian(const SolverOptions &options, MPI_Comm comm);
+
+#endif
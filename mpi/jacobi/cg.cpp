@@ -0,0 +1,144 @@
+#include <vector>
+#include <cmath> // For std::sqrt
+#include <mpi.h>
+#include "cg.h"
+
+void apply_operator(HaloExchange &halo, std::vector<double> &v, std::vector<double> &av, int count);
+void apply_points(const double *v, double *av, int first, int last);
+
+bool cg_solve(float *slab, int count, HaloExchange &halo, bool pipelined, double tolerance,
+              int max_iterations, int &iterations, double &residual_norm, PhaseTimes *times)
+{
+    // Vectors hold the slab at 1..count; those multiplied by A also use the ghost cells
+    // at 0 and count + 1. s = A p and, when pipelined, z = A s and q = A w are kept up to
+    // date by recurrences, so every iteration does a single matrix-vector product.
+    std::vector<double> x(count + 2), r(count + 2), w(count + 2);
+    std::vector<double> p(count + 2, 0.0), s(count + 2, 0.0);
+    std::vector<double> q, z;
+    if (pipelined)
+    {
+        q.assign(count + 2, 0.0);
+        z.assign(count + 2, 0.0);
+    }
+    double local_dots[2] = {0.0, 0.0}; // (r, r) and (w, r), reduced together
+    double global_dots[2];
+    double gamma_old = 0.0;
+    double alpha_old = 0.0;
+
+    for (int i = 1; i <= count; ++i)
+    {
+        x[i] = slab[i - 1];
+    }
+    // The right-hand side is zero, so the initial residual is -A x
+    apply_operator(halo, x, r, count);
+    for (int i = 1; i <= count; ++i)
+    {
+        r[i] = -r[i];
+    }
+    apply_operator(halo, r, w, count);
+    for (int i = 1; i <= count; ++i)
+    {
+        local_dots[0] += r[i] * r[i];
+        local_dots[1] += w[i] * r[i];
+    }
+
+    iterations = 0;
+    bool converged = false;
+    while (true)
+    {
+        double start = phase_clock(times);
+        if (pipelined)
+        {
+            MPI_Request request;
+            MPI_Iallreduce(local_dots, global_dots, 2, MPI_DOUBLE, MPI_SUM, halo.comm, &request);
+            phase_add(times, PHASE_REDUCE, start);
+            apply_operator(halo, w, q, count); // q = A w while the dot products travel
+            start = phase_clock(times);
+            MPI_Wait(&request, MPI_STATUS_IGNORE);
+        }
+        else
+        {
+            MPI_Allreduce(local_dots, global_dots, 2, MPI_DOUBLE, MPI_SUM, halo.comm);
+        }
+        phase_add(times, PHASE_REDUCE, start);
+        double gamma = global_dots[0];
+        double delta = global_dots[1];
+        residual_norm = std::sqrt(gamma);
+        if (residual_norm < tolerance)
+        {
+            converged = true;
+            break;
+        }
+        if (iterations == max_iterations)
+        {
+            break;
+        }
+
+        // (p, A p) is recovered from the two reduced dot products, so no second reduction is needed
+        double beta = (iterations == 0) ? 0.0 : gamma / gamma_old;
+        double alpha = (iterations == 0) ? gamma / delta : gamma / (delta - beta * gamma / alpha_old);
+        local_dots[0] = 0.0;
+        local_dots[1] = 0.0;
+        if (pipelined)
+        {
+            // One pass updates every vector and computes the next iteration's dot products
+            for (int i = 1; i <= count; ++i)
+            {
+                z[i] = q[i] + beta * z[i];
+                s[i] = w[i] + beta * s[i];
+                p[i] = r[i] + beta * p[i];
+                x[i] += alpha * p[i];
+                r[i] -= alpha * s[i];
+                w[i] -= alpha * z[i];
+                local_dots[0] += r[i] * r[i];
+                local_dots[1] += w[i] * r[i];
+            }
+        }
+        else
+        {
+            for (int i = 1; i <= count; ++i)
+            {
+                p[i] = r[i] + beta * p[i];
+                s[i] = w[i] + beta * s[i];
+                x[i] += alpha * p[i];
+                r[i] -= alpha * s[i];
+            }
+            apply_operator(halo, r, w, count);
+            for (int i = 1; i <= count; ++i)
+            {
+                local_dots[0] += r[i] * r[i];
+                local_dots[1] += w[i] * r[i];
+            }
+        }
+        gamma_old = gamma;
+        alpha_old = alpha;
+        iterations++;
+    }
+
+    for (int i = 1; i <= count; ++i)
+    {
+        slab[i - 1] = (float)x[i];
+    }
+    return converged;
+}
+
+// av = A v. As in do_one_step, the interior is computed while the ghost cells of v are in flight.
+void apply_operator(HaloExchange &halo, std::vector<double> &v, std::vector<double> &av, int count)
+{
+    halo_start(halo, v.data(), count);
+    apply_points(v.data(), av.data(), 2, count - 1);
+    halo_finish(halo);
+    apply_points(v.data(), av.data(), 1, 1);
+    if (count > 1)
+    {
+        apply_points(v.data(), av.data(), count, count);
+    }
+}
+
+void apply_points(const double *v, double *av, int first, int last)
+{
+    for (int i = first; i <= last; ++i)
+    {
+        av[i] = 2.0 * v[i] - v[i - 1] - v[i + 1];
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef JACOBI_CG_H
+#define JACOBI_CG_H
+
+#include "halo.h"
+#include "timing.h"
+
+// Solves the ring A x = 0, A = [-1 2 -1] with wrap-around, by conjugate gradients starting
+// from the values in slab (the `count` points this rank owns), which receive the result.
+// A is only semi-definite, but its null space is the constant vectors, which the residuals
+// never contain; CG converges to the mean of the ring, like the Jacobi iteration.
+// The halo must have depth 1. With `pipelined`, the one reduction of every iteration is
+// overlapped with the matrix-vector product (Ghysels and Vanroose); otherwise it is a single
+// blocking reduction of both dot products (Chronopoulos and Gear). Iterates until the
+// residual 2-norm is below tolerance or max_iterations; returns whether it converged.
+// Reduction time is added to times, nullptr to not time.
+bool cg_solve(float *slab, int count, HaloExchange &halo, bool pipelined, double tolerance,
+              int max_iterations, int &iterations, double &residual_norm, PhaseTimes *times);
+
+#endif
@@ -0,0 +1,219 @@
+#include <cstdlib> // For malloc, free
+#include <cstring> // For std::memcpy, std::memcmp
+#include "array_io.h"
+#include "checkpoint.h"
+
+// Trailer: iteration as int64_t, error as float, 4 bytes of padding, then the magic
+#define CHECKPOINT_MAGIC "JACOBICK"
+#define CHECKPOINT_TRAILER_SIZE 24
+
+bool complete_checkpoint(Checkpoint &checkpoint);
+bool read_checkpoint_trailer(const std::string &path, MPI_Comm comm, int64_t &num_points, int &iteration, float &error);
+
+void checkpoint_init(Checkpoint &checkpoint, const std::string &prefix, int interval, int first_iteration,
+                     int64_t num_points, int64_t first_index, int count, MPI_Comm comm)
+{
+    checkpoint.prefix = prefix;
+    checkpoint.interval = interval;
+    checkpoint.comm = comm;
+    checkpoint.num_points = num_points;
+    checkpoint.first_index = first_index;
+    checkpoint.count = count;
+    checkpoint.snapshot = (float *)malloc(sizeof(float) * count);
+    checkpoint.request = MPI_REQUEST_NULL;
+    checkpoint.in_flight = false;
+    checkpoint.pending_iteration = 0;
+    checkpoint.pending_error = 0.0f;
+    checkpoint.next_file = 0;
+
+    // A resumed run starts on the older file, so the checkpoint it resumed from survives
+    // until a newer one is complete
+    if (first_iteration > 0)
+    {
+        int64_t saved_points;
+        int saved_iteration;
+        float saved_error;
+        if (read_checkpoint_trailer(prefix + ".0", comm, saved_points, saved_iteration, saved_error) &&
+            saved_iteration == first_iteration)
+        {
+            checkpoint.next_file = 1;
+        }
+    }
+
+    bool success = true;
+    int opened = 0;
+    for (; opened < 2; ++opened)
+    {
+        std::string path = prefix + "." + std::to_string(opened);
+        if (MPI_File_open(comm, path.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                          &checkpoint.files[opened]) != MPI_SUCCESS)
+        {
+            success = false;
+            break;
+        }
+        // Checkpoints of an earlier run must not look newer than the ones written now
+        if (first_iteration == 0)
+        {
+            success = MPI_File_set_size(checkpoint.files[opened], 0) == MPI_SUCCESS && success;
+        }
+    }
+    if (!success)
+    {
+        for (int f = 0; f < opened; ++f)
+        {
+            MPI_File_close(&checkpoint.files[f]);
+        }
+    }
+    checkpoint.files_open = success;
+}
+
+bool checkpoint_step(Checkpoint &checkpoint, int iteration, float local_error, const float *slab)
+{
+    if (checkpoint.in_flight)
+    {
+        // Lets the write make progress in MPI implementations without an I/O progress thread
+        int done;
+        MPI_Test(&checkpoint.request, &done, MPI_STATUS_IGNORE);
+    }
+    if (iteration % checkpoint.interval != 0)
+    {
+        return true;
+    }
+    if (!checkpoint.files_open)
+    {
+        return false;
+    }
+
+    int rank;
+    MPI_Comm_rank(checkpoint.comm, &rank);
+    bool success = complete_checkpoint(checkpoint);
+
+    MPI_File file = checkpoint.files[checkpoint.next_file];
+    checkpoint.next_file = 1 - checkpoint.next_file;
+    // The file may still hold an older complete checkpoint. Its magic has to be gone from the
+    // disk before any of its data is overwritten, or a crash during the write would leave the
+    // stale trailer vouching for a mix of old and new points.
+    char cleared[8] = {0};
+    MPI_Offset magic_offset = ARRAY_FILE_HEADER_SIZE + checkpoint.num_points * (MPI_Offset)sizeof(float) + 16;
+    success = MPI_File_write_at_all(file, magic_offset, cleared, rank == 0 ? 8 : 0,
+                                    MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS && success;
+    success = MPI_File_sync(file) == MPI_SUCCESS && success;
+
+    std::memcpy(checkpoint.snapshot, slab, sizeof(float) * checkpoint.count);
+    MPI_Offset offset = ARRAY_FILE_HEADER_SIZE + checkpoint.first_index * (MPI_Offset)sizeof(float);
+    success = MPI_File_iwrite_at_all(file, offset, checkpoint.snapshot, checkpoint.count,
+                                     MPI_FLOAT, &checkpoint.request) == MPI_SUCCESS && success;
+    checkpoint.in_flight = true;
+    checkpoint.pending_iteration = iteration;
+    checkpoint.pending_error = local_error;
+
+    return all_ranks_succeeded(success, checkpoint.comm);
+}
+
+bool checkpoint_finish(Checkpoint &checkpoint)
+{
+    bool success = checkpoint.files_open;
+    if (checkpoint.files_open)
+    {
+        success = complete_checkpoint(checkpoint);
+        for (int f = 0; f < 2; ++f)
+        {
+            success = MPI_File_close(&checkpoint.files[f]) == MPI_SUCCESS && success;
+        }
+        checkpoint.files_open = false;
+    }
+    success = all_ranks_succeeded(success, checkpoint.comm);
+    free(checkpoint.snapshot);
+    checkpoint.snapshot = nullptr;
+    return success;
+}
+
+// Waits for the data of the checkpoint in flight, then marks it complete with its header and
+// trailer. The trailer holds the global error of the saved iteration, not of a later one.
+bool complete_checkpoint(Checkpoint &checkpoint)
+{
+    if (!checkpoint.in_flight)
+    {
+        return true;
+    }
+
+    int rank;
+    char header[ARRAY_FILE_HEADER_SIZE];
+    char trailer[CHECKPOINT_TRAILER_SIZE] = {0};
+    int64_t iteration = checkpoint.pending_iteration;
+    float error;
+    MPI_File file = checkpoint.files[1 - checkpoint.next_file];
+    MPI_Comm_rank(checkpoint.comm, &rank);
+    MPI_Allreduce(&checkpoint.pending_error, &error, 1, MPI_FLOAT, MPI_MAX, checkpoint.comm);
+    std::memcpy(header, ARRAY_FILE_MAGIC, 8);
+    std::memcpy(header + 8, &checkpoint.num_points, sizeof(checkpoint.num_points));
+    std::memcpy(trailer, &iteration, sizeof(iteration));
+    std::memcpy(trailer + 8, &error, sizeof(float));
+    std::memcpy(trailer + 16, CHECKPOINT_MAGIC, 8);
+
+    bool success = MPI_Wait(&checkpoint.request, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    success = MPI_File_write_at_all(file, 0, header, rank == 0 ? ARRAY_FILE_HEADER_SIZE : 0,
+                                    MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS && success;
+    // The data must be on disk before the trailer claims it is
+    success = MPI_File_sync(file) == MPI_SUCCESS && success;
+    MPI_Offset offset = ARRAY_FILE_HEADER_SIZE + checkpoint.num_points * (MPI_Offset)sizeof(float);
+    success = MPI_File_write_at_all(file, offset, trailer, rank == 0 ? CHECKPOINT_TRAILER_SIZE : 0,
+                                    MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS && success;
+    // Only a trailer on disk makes the checkpoint one a restart can rely on
+    success = MPI_File_sync(file) == MPI_SUCCESS && success;
+    checkpoint.in_flight = false;
+    return success;
+}
+
+bool checkpoint_find_latest(const std::string &prefix, MPI_Comm comm, std::string &path,
+                            int64_t &num_points, int &iteration, float &error)
+{
+    bool found = false;
+    for (int f = 0; f < 2; ++f)
+    {
+        std::string candidate = prefix + "." + std::to_string(f);
+        int64_t candidate_points;
+        int candidate_iteration;
+        float candidate_error;
+        if (read_checkpoint_trailer(candidate, comm, candidate_points, candidate_iteration, candidate_error) &&
+            (!found || candidate_iteration > iteration))
+        {
+            found = true;
+            path = candidate;
+            num_points = candidate_points;
+            iteration = candidate_iteration;
+            error = candidate_error;
+        }
+    }
+    return found;
+}
+
+// Reads the header and trailer of a checkpoint file; false if it is missing or incomplete
+bool read_checkpoint_trailer(const std::string &path, MPI_Comm comm, int64_t &num_points, int &iteration, float &error)
+{
+    MPI_File file;
+    char trailer[CHECKPOINT_TRAILER_SIZE];
+    int64_t saved_iteration;
+
+    // A file without its trailer fails the length check
+    if (!read_array_size(path.c_str(), comm, CHECKPOINT_TRAILER_SIZE, num_points))
+    {
+        return false;
+    }
+    if (MPI_File_open(comm, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
+        return false;
+    }
+    MPI_Offset offset = ARRAY_FILE_HEADER_SIZE + num_points * (MPI_Offset)sizeof(float);
+    bool success = MPI_File_read_at_all(file, offset, trailer, CHECKPOINT_TRAILER_SIZE, MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    MPI_File_close(&file);
+
+    if (!success || std::memcmp(trailer + 16, CHECKPOINT_MAGIC, 8) != 0)
+    {
+        return false;
+    }
+    std::memcpy(&saved_iteration, trailer, sizeof(saved_iteration));
+    std::memcpy(&error, trailer + 8, sizeof(float));
+    iteration = (int)saved_iteration;
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef JACOBI_CHECKPOINT_H
+#define JACOBI_CHECKPOINT_H
+
+#include <string>
+#include <cstdint> // For int64_t
+#include <mpi.h>
+
+// A checkpoint is an array file (see array_io.h) followed by a trailer holding the iteration
+// count and error. The trailer is written last, so a file without it is incomplete. Two files,
+// <prefix>.0 and <prefix>.1, are used in turn, so one complete checkpoint always survives.
+//
+// Both files stay open for the whole run. Taking a checkpoint clears the magic of the target
+// file's old trailer on disk, so a write cut short never leaves a file that looks complete,
+// then copies the slab into a snapshot and starts MPI_File_iwrite_at_all, while the solver
+// carries on. The write is completed, the file synced and its header and trailer added and
+// synced when the next checkpoint starts or when the run ends, so a checkpoint becomes usable
+// one interval after it was taken.
+struct Checkpoint
+{
+    std::string prefix;
+    int interval;
+    MPI_Comm comm;
+    int64_t num_points;
+    int64_t first_index;
+    int count;
+    float *snapshot;
+    MPI_File files[2];
+    bool files_open;
+    MPI_Request request;
+    bool in_flight;
+    int pending_iteration;
+    float pending_error;   // this rank's error of pending_iteration, reduced at completion
+    int next_file;
+};
+
+// Opens both files. A run resuming at first_iteration > 0 keeps the checkpoint it resumed
+// from and writes to the other file first; any other run empties both.
+void checkpoint_init(Checkpoint &checkpoint, const std::string &prefix, int interval, int first_iteration,
+                     int64_t num_points, int64_t first_index, int count, MPI_Comm comm);
+// Called after every iteration with the slab's own points and this rank's error of that
+// iteration. Returns false on every rank if a checkpoint could not be written.
+bool checkpoint_step(Checkpoint &checkpoint, int iteration, float local_error, const float *slab);
+// Completes the checkpoint still in flight and releases the snapshot
+bool checkpoint_finish(Checkpoint &checkpoint);
+
+// Finds the newest complete checkpoint with the given prefix; false if there is none
+bool checkpoint_find_latest(const std::string &prefix, MPI_Comm comm, std::string &path,
+                            int64_t &num_points, int &iteration, float &error);
+
+#endif
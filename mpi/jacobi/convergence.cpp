@@ -0,0 +1,98 @@
+#include <iostream>
+#include <limits>
+#include "convergence.h"
+
+bool check_reduced_errors(ConvergenceCheck &check, int first_iteration);
+
+void convergence_init(ConvergenceCheck &check, int interval, bool async, float acceptable_error, MPI_Comm comm)
+{
+    check.interval = interval;
+    check.async = async;
+    check.acceptable_error = acceptable_error;
+    check.comm = comm;
+    // Iterations that never ran, e.g. before a restart, must not look converged
+    float not_run = std::numeric_limits<float>::max();
+    check.local_errors.assign(interval, not_run);
+    check.pending_errors.assign(interval, not_run);
+    check.global_errors.assign(interval, not_run);
+    check.request = MPI_REQUEST_NULL;
+    check.pending_first_iteration = 0;
+    check.converged_iteration = 0;
+    check.global_error = acceptable_error + 1.0f;
+    check.times = nullptr;
+}
+
+bool convergence_record(ConvergenceCheck &check, int iteration, float local_error)
+{
+    check.local_errors[(iteration - 1) % check.interval] = local_error;
+    if (iteration % check.interval != 0)
+    {
+        return false;
+    }
+
+    int first_iteration = iteration - check.interval + 1;
+    if (!check.async)
+    {
+        // One reduction of `interval` floats costs about the same as one of a single float
+        double start = phase_clock(check.times);
+        MPI_Allreduce(check.local_errors.data(), check.global_errors.data(), check.interval,
+                      MPI_FLOAT, MPI_MAX, check.comm);
+        phase_add(check.times, PHASE_REDUCE, start);
+        return check_reduced_errors(check, first_iteration);
+    }
+
+    // The reduction started `interval` iterations ago has had a full window to complete
+    double start = phase_clock(check.times);
+    if (check.request != MPI_REQUEST_NULL)
+    {
+        MPI_Wait(&check.request, MPI_STATUS_IGNORE);
+        phase_add(check.times, PHASE_REDUCE, start);
+        if (check_reduced_errors(check, check.pending_first_iteration))
+        {
+            return true;
+        }
+    }
+    check.pending_errors.swap(check.local_errors);
+    check.pending_first_iteration = first_iteration;
+    start = phase_clock(check.times);
+    MPI_Iallreduce(check.pending_errors.data(), check.global_errors.data(), check.interval,
+                   MPI_FLOAT, MPI_MAX, check.comm, &check.request);
+    phase_add(check.times, PHASE_REDUCE, start);
+    return false;
+}
+
+void convergence_finish(ConvergenceCheck &check)
+{
+    if (check.request != MPI_REQUEST_NULL)
+    {
+        double start = phase_clock(check.times);
+        MPI_Wait(&check.request, MPI_STATUS_IGNORE);
+        phase_add(check.times, PHASE_REDUCE, start);
+        check_reduced_errors(check, check.pending_first_iteration);
+    }
+}
+
+// Scans a reduced window for the first iteration at or below the threshold
+bool check_reduced_errors(ConvergenceCheck &check, int first_iteration)
+{
+    for (int i = 0; i < check.interval; ++i)
+    {
+        check.global_error = check.global_errors[i];
+        if (check.global_error <= check.acceptable_error)
+        {
+            check.converged_iteration = first_iteration + i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Says how many sweeps ran after the one that met the threshold, when checks are amortised
+void report_extra_iterations(const ConvergenceCheck &check, int iterations)
+{
+    if (check.converged_iteration > 0 && (check.interval > 1 || check.async))
+    {
+        std::cout << "Convergence reached at iteration " << check.converged_iteration << ", "
+                  << iterations - check.converged_iteration << " extra iterations run" << std::endl;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef JACOBI_CONVERGENCE_H
+#define JACOBI_CONVERGENCE_H
+
+#include <vector>
+#include <mpi.h>
+#include "timing.h"
+
+// Global convergence test that only synchronises every `interval` iterations. The local
+// errors of all iterations in between travel in one reduction, so the exact iteration at
+// which the global error first dropped below the threshold is still known afterwards.
+// With `async` the reduction is an MPI_Iallreduce that completes during the next
+// `interval` sweeps, which costs up to 2 * interval - 1 extra iterations.
+struct ConvergenceCheck
+{
+    int interval;
+    bool async;
+    float acceptable_error;
+    MPI_Comm comm;
+    std::vector<float> local_errors;   // errors of the iterations since the last check
+    std::vector<float> pending_errors; // send buffer of the reduction in flight
+    std::vector<float> global_errors;  // result of the last reduction
+    MPI_Request request;
+    int pending_first_iteration;       // iteration of pending_errors[0]
+    int converged_iteration;           // first iteration below the threshold, 0 if none yet
+    float global_error;                // latest known global error
+    PhaseTimes *times;                 // reduction time is added here, nullptr to not time
+};
+
+void convergence_init(ConvergenceCheck &check, int interval, bool async, float acceptable_error, MPI_Comm comm);
+// Records the local error of `iteration` (counted from 1). Returns true on every rank once
+// the global error of some iteration is known to be at or below the threshold.
+bool convergence_record(ConvergenceCheck &check, int iteration, float local_error);
+// Completes a reduction still in flight, e.g. after leaving the loop at the iteration cap
+void convergence_finish(ConvergenceCheck &check);
+void report_extra_iterations(const ConvergenceCheck &check, int iterations);
+
+#endif
@@ -0,0 +1,46 @@
+#include <cmath>     // For std::floor
+#include <algorithm> // For std::sort
+#include "decomposition.h"
+
+bool partition_array(int64_t arr_size, int num_of_processes, const std::vector<double> &weights,
+                     int min_points, std::vector<int64_t> &counts, std::vector<int64_t> &displs)
+{
+    double total_weight = 0.0;
+    for (int p = 0; p < num_of_processes; ++p)
+    {
+        total_weight += weights.empty() ? 1.0 : weights[p];
+    }
+
+    // Round every share down, then hand the leftover points to the largest remainders
+    std::vector<std::pair<double, int> > remainders(num_of_processes);
+    int64_t assigned = 0;
+    counts.assign(num_of_processes, 0);
+    for (int p = 0; p < num_of_processes; ++p)
+    {
+        double share = (double)arr_size * (weights.empty() ? 1.0 : weights[p]) / total_weight;
+        counts[p] = (int64_t)std::floor(share);
+        // Negated rank breaks ties towards the lower rank, matching an even split's remainder
+        remainders[p] = std::make_pair(share - counts[p], -p);
+        assigned += counts[p];
+    }
+    std::sort(remainders.begin(), remainders.end());
+    for (int64_t i = 0; i < arr_size - assigned; ++i)
+    {
+        counts[-remainders[num_of_processes - 1 - i].second]++;
+    }
+
+    displs.assign(num_of_processes, 0);
+    for (int p = 1; p < num_of_processes; ++p)
+    {
+        displs[p] = displs[p - 1] + counts[p - 1];
+    }
+
+    for (int p = 0; p < num_of_processes; ++p)
+    {
+        if (counts[p] < min_points)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef JACOBI_DECOMPOSITION_H
+#define JACOBI_DECOMPOSITION_H
+
+#include <vector>
+#include <cstdint> // For int64_t
+
+// Splits arr_size points into one contiguous slab per process, in rank order. Slab sizes
+// follow the relative weights (equal when weights is empty, so sizes differ by at most one)
+// and always add up to arr_size. displs holds the global index of every slab's first point.
+// Returns false if a slab would get fewer than min_points.
+bool partition_array(int64_t arr_size, int num_of_processes, const std::vector<double> &weights,
+                     int min_points, std::vector<int64_t> &counts, std::vector<int64_t> &displs);
+
+#endif
@@ -0,0 +1,393 @@
+#include <cstring> // For std::strcmp, std::memcpy
+#include <thread>  // For std::this_thread::yield
+#include "halo.h"
+
+// Values travelling to the left neighbour and to the right neighbour use different tags,
+// so the two messages cannot be mismatched when both neighbours are the same rank (np <= 2).
+#define TAG_TO_LEFT 0
+#define TAG_TO_RIGHT 1
+
+// Room for one point of any type the solvers exchange
+#define HALO_POINT_BYTES sizeof(double)
+// Shared mode flags at the start of every segment, each written only by the segment's owner:
+// the number of exchanges it has published, and of its left and right neighbours' exchanges
+// it has finished reading
+#define FLAG_PUBLISHED 0
+#define FLAG_READ_LEFT 1
+#define FLAG_READ_RIGHT 2
+#define SHARED_FLAGS_BYTES (3 * sizeof(long long))
+// Polls of a flag before each further poll yields the core, in case the neighbour shares it
+#define SHARED_SPINS 1000
+
+template <typename T>
+void start_exchange(HaloExchange &halo, T *local, int size_per_process, MPI_Datatype type);
+char *node_segment(HaloExchange &halo, int process);
+long long *shared_flag(char *segment, int flag);
+void wait_for_flag(HaloExchange &halo, char *segment, int flag, long long value);
+
+void halo_init(HaloExchange &halo, HaloMode mode, int depth, int width, int left_process, int right_process, MPI_Comm comm)
+{
+    halo.mode = mode;
+    halo.depth = depth;
+    halo.width = width;
+    halo.comm = comm;
+    halo.left_process = left_process;
+    halo.right_process = right_process;
+    halo.message_tag = 0;
+    halo.times = nullptr;
+    for (int i = 0; i < 4; ++i)
+    {
+        halo.requests[i] = MPI_REQUEST_NULL;
+    }
+    for (int set = 0; set < HALO_PERSISTENT_SETS; ++set)
+    {
+        halo.persistent[set].buffer = nullptr;
+    }
+    halo.next_persistent = 0;
+    halo.active = -1;
+
+    if (mode == HALO_SHARED)
+    {
+        // Segment layout: the flags, then slot 0 first points, slot 0 last points, slot 1 first,
+        // slot 1 last
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &halo.node_comm);
+        MPI_Win_allocate_shared(SHARED_FLAGS_BYTES + 4 * depth * width * HALO_POINT_BYTES, 1, MPI_INFO_NULL,
+                                halo.node_comm, &halo.segment, &halo.window);
+        for (int flag = FLAG_PUBLISHED; flag <= FLAG_READ_RIGHT; ++flag)
+        {
+            *shared_flag(halo.segment, flag) = 0;
+        }
+        // One passive epoch for the lifetime of the window; MPI_Win_sync orders the loads and
+        // stores. The flags must be zero on the whole node before anyone polls them.
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, halo.window);
+        MPI_Win_sync(halo.window);
+        MPI_Barrier(halo.node_comm);
+        MPI_Win_sync(halo.window);
+        halo.left_segment = node_segment(halo, left_process);
+        halo.right_segment = node_segment(halo, right_process);
+        halo.exchanges = 0;
+    }
+    else if (mode == HALO_RMA)
+    {
+        MPI_Win_allocate(2 * depth * width * HALO_POINT_BYTES, 1, MPI_INFO_NULL, comm, &halo.segment, &halo.window);
+        // Epochs only involve the neighbours, unlike a fence over the whole communicator
+        int ranks[2] = {left_process, right_process};
+        MPI_Group group;
+        MPI_Comm_group(comm, &group);
+        MPI_Group_incl(group, left_process == right_process ? 1 : 2, ranks, &halo.neighbours);
+        MPI_Group_free(&group);
+    }
+}
+
+// Address of the segment of `process` (a rank of halo.comm) if it shares this node
+char *node_segment(HaloExchange &halo, int process)
+{
+    MPI_Group group, node_group;
+    int node_rank;
+    MPI_Comm_group(halo.comm, &group);
+    MPI_Comm_group(halo.node_comm, &node_group);
+    MPI_Group_translate_ranks(group, 1, &process, node_group, &node_rank);
+    MPI_Group_free(&group);
+    MPI_Group_free(&node_group);
+    if (node_rank == MPI_UNDEFINED)
+    {
+        return nullptr;
+    }
+
+    MPI_Aint size;
+    int disp_unit;
+    char *segment;
+    MPI_Win_shared_query(halo.window, node_rank, &size, &disp_unit, &segment);
+    return segment;
+}
+
+long long *shared_flag(char *segment, int flag)
+{
+    return (long long *)segment + flag;
+}
+
+// Polls a neighbour's flag until it reaches value. Only the two ranks involved take part, so
+// a slow rank elsewhere on the node holds up no one but its own neighbours.
+void wait_for_flag(HaloExchange &halo, char *segment, int flag, long long value)
+{
+    int spins = 0;
+    while (__atomic_load_n(shared_flag(segment, flag), __ATOMIC_ACQUIRE) < value)
+    {
+        MPI_Win_sync(halo.window);
+        if (++spins > SHARED_SPINS)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void halo_start(HaloExchange &halo, float *local, int size_per_process)
+{
+    double start = phase_clock(halo.times);
+    start_exchange(halo, local, size_per_process, MPI_FLOAT);
+    phase_add(halo.times, PHASE_HALO, start);
+}
+
+// Multigrid levels are kept in double precision
+void halo_start(HaloExchange &halo, double *local, int size_per_process)
+{
+    double start = phase_clock(halo.times);
+    start_exchange(halo, local, size_per_process, MPI_DOUBLE);
+    phase_add(halo.times, PHASE_HALO, start);
+}
+
+template <typename T>
+void start_exchange(HaloExchange &halo, T *local, int size_per_process, MPI_Datatype type)
+{
+    int to_left = halo.message_tag + TAG_TO_LEFT;
+    int to_right = halo.message_tag + TAG_TO_RIGHT;
+    int width = halo.width;
+    // Ghost cells and boundary points to move on each side, `width` values per point
+    int values = halo.depth * width;
+    T *left_ghost = &local[0];
+    T *first_points = &local[values];
+    T *last_points = &local[(size_t)size_per_process * width];
+    T *right_ghost = &local[(size_t)size_per_process * width + values];
+    // Only what travels in messages counts; neighbours on the same node copy through memory
+    if (halo.times)
+    {
+        int messages = 2;
+        if (halo.mode == HALO_SHARED)
+        {
+            messages = (halo.left_segment == nullptr) + (halo.right_segment == nullptr);
+        }
+        halo.times->bytes_sent += messages * values * sizeof(T);
+    }
+
+    if (halo.mode == HALO_BLOCKING)
+    {
+        // Send the leftmost points to left neighbour, receive into the right ghost cells from right neighbour
+        MPI_Sendrecv(first_points, values, type, halo.left_process, to_left,
+                     right_ghost, values, type, halo.right_process, to_left,
+                     halo.comm, MPI_STATUS_IGNORE);
+
+        // Send the rightmost points to right neighbour, receive into the left ghost cells from left neighbour
+        MPI_Sendrecv(last_points, values, type, halo.right_process, to_right,
+                     left_ghost, values, type, halo.left_process, to_right,
+                     halo.comm, MPI_STATUS_IGNORE);
+        return;
+    }
+
+    if (halo.mode == HALO_SHARED)
+    {
+        size_t bytes = values * sizeof(T);
+        size_t slot_offset = SHARED_FLAGS_BYTES + halo.exchanges % 2 * 2 * values * HALO_POINT_BYTES;
+        size_t last_offset = values * HALO_POINT_BYTES;
+        long long exchange = ++halo.exchanges;
+
+        // Messages only for neighbours on other nodes; the rest of requests[] stays null
+        for (int i = 0; i < 4; ++i)
+        {
+            halo.requests[i] = MPI_REQUEST_NULL;
+        }
+        if (halo.right_segment == nullptr)
+        {
+            MPI_Irecv(right_ghost, values, type, halo.right_process, to_left, halo.comm, &halo.requests[0]);
+            MPI_Isend(last_points, values, type, halo.right_process, to_right, halo.comm, &halo.requests[3]);
+        }
+        if (halo.left_segment == nullptr)
+        {
+            MPI_Irecv(left_ghost, values, type, halo.left_process, to_right, halo.comm, &halo.requests[1]);
+            MPI_Isend(first_points, values, type, halo.left_process, to_left, halo.comm, &halo.requests[2]);
+        }
+
+        // The slot was last written two exchanges ago; both neighbours on this node must have
+        // read it. Then publish this slab's boundary points and announce them. halo_finish
+        // waits for the neighbours' announcements and copies their points into the ghost cells.
+        if (halo.left_segment != nullptr)
+        {
+            wait_for_flag(halo, halo.left_segment, FLAG_READ_RIGHT, exchange - 2);
+        }
+        if (halo.right_segment != nullptr)
+        {
+            wait_for_flag(halo, halo.right_segment, FLAG_READ_LEFT, exchange - 2);
+        }
+        std::memcpy(halo.segment + slot_offset, first_points, bytes);
+        std::memcpy(halo.segment + slot_offset + last_offset, last_points, bytes);
+        MPI_Win_sync(halo.window);
+        __atomic_store_n(shared_flag(halo.segment, FLAG_PUBLISHED), exchange, __ATOMIC_RELEASE);
+        halo.left_ghost = left_ghost;
+        halo.right_ghost = right_ghost;
+        halo.ghost_bytes = bytes;
+        return;
+    }
+
+    if (halo.mode == HALO_RMA)
+    {
+        // Expose this rank's ghost window to the neighbours and write into theirs: the first
+        // points become the left neighbour's right ghost cells and the last points the right
+        // neighbour's left ghost cells
+        MPI_Aint right_ghost_offset = values * HALO_POINT_BYTES;
+        MPI_Win_post(halo.neighbours, 0, halo.window);
+        MPI_Win_start(halo.neighbours, 0, halo.window);
+        MPI_Put(first_points, values, type, halo.left_process, right_ghost_offset, values, type, halo.window);
+        MPI_Put(last_points, values, type, halo.right_process, 0, values, type, halo.window);
+        halo.left_ghost = left_ghost;
+        halo.right_ghost = right_ghost;
+        halo.ghost_bytes = values * sizeof(T);
+        return;
+    }
+
+    if (halo.mode == HALO_PERSISTENT)
+    {
+        int set = 0;
+        while (set < HALO_PERSISTENT_SETS &&
+               !(halo.persistent[set].buffer == local && halo.persistent[set].size_per_process == size_per_process &&
+                 halo.persistent[set].type == type))
+        {
+            set++;
+        }
+        if (set == HALO_PERSISTENT_SETS)
+        {
+            // First exchange of this buffer: replace the oldest set
+            set = halo.next_persistent;
+            halo.next_persistent = (set + 1) % HALO_PERSISTENT_SETS;
+            PersistentHalo &persistent = halo.persistent[set];
+            if (persistent.buffer != nullptr)
+            {
+                for (int i = 0; i < 4; ++i)
+                {
+                    MPI_Request_free(&persistent.requests[i]);
+                }
+            }
+            persistent.buffer = local;
+            persistent.size_per_process = size_per_process;
+            persistent.type = type;
+            MPI_Recv_init(right_ghost, values, type, halo.right_process, to_left, halo.comm, &persistent.requests[0]);
+            MPI_Recv_init(left_ghost, values, type, halo.left_process, to_right, halo.comm, &persistent.requests[1]);
+            MPI_Send_init(first_points, values, type, halo.left_process, to_left, halo.comm, &persistent.requests[2]);
+            MPI_Send_init(last_points, values, type, halo.right_process, to_right, halo.comm, &persistent.requests[3]);
+        }
+        halo.active = set;
+        MPI_Startall(4, halo.persistent[set].requests);
+        return;
+    }
+
+    // Post the receives first so the incoming values never wait in an unexpected-message queue
+    MPI_Irecv(right_ghost, values, type, halo.right_process, to_left, halo.comm, &halo.requests[0]);
+    MPI_Irecv(left_ghost, values, type, halo.left_process, to_right, halo.comm, &halo.requests[1]);
+    MPI_Isend(first_points, values, type, halo.left_process, to_left, halo.comm, &halo.requests[2]);
+    MPI_Isend(last_points, values, type, halo.right_process, to_right, halo.comm, &halo.requests[3]);
+}
+
+void halo_finish(HaloExchange &halo)
+{
+    double start = phase_clock(halo.times);
+    if (halo.mode == HALO_NONBLOCKING)
+    {
+        MPI_Waitall(4, halo.requests, MPI_STATUSES_IGNORE);
+    }
+    else if (halo.mode == HALO_SHARED)
+    {
+        MPI_Waitall(4, halo.requests, MPI_STATUSES_IGNORE);
+        long long exchange = halo.exchanges;
+        size_t slot_offset = SHARED_FLAGS_BYTES + (exchange - 1) % 2 * 2 * halo.depth * halo.width * HALO_POINT_BYTES;
+        size_t last_offset = halo.depth * halo.width * HALO_POINT_BYTES;
+        if (halo.right_segment != nullptr)
+        {
+            wait_for_flag(halo, halo.right_segment, FLAG_PUBLISHED, exchange);
+            std::memcpy(halo.right_ghost, halo.right_segment + slot_offset, halo.ghost_bytes);
+        }
+        if (halo.left_segment != nullptr)
+        {
+            wait_for_flag(halo, halo.left_segment, FLAG_PUBLISHED, exchange);
+            std::memcpy(halo.left_ghost, halo.left_segment + slot_offset + last_offset, halo.ghost_bytes);
+        }
+        // Lets the neighbours reuse this slot two exchanges from now
+        MPI_Win_sync(halo.window);
+        __atomic_store_n(shared_flag(halo.segment, FLAG_READ_RIGHT), exchange, __ATOMIC_RELEASE);
+        __atomic_store_n(shared_flag(halo.segment, FLAG_READ_LEFT), exchange, __ATOMIC_RELEASE);
+    }
+    else if (halo.mode == HALO_PERSISTENT)
+    {
+        // Completed persistent requests become inactive, ready for the next MPI_Startall
+        MPI_Waitall(4, halo.persistent[halo.active].requests, MPI_STATUSES_IGNORE);
+    }
+    else if (halo.mode == HALO_RMA)
+    {
+        // Complete this rank's puts, then wait for the neighbours' before reading the window
+        MPI_Win_complete(halo.window);
+        MPI_Win_wait(halo.window);
+        std::memcpy(halo.left_ghost, halo.segment, halo.ghost_bytes);
+        std::memcpy(halo.right_ghost, halo.segment + halo.depth * halo.width * HALO_POINT_BYTES, halo.ghost_bytes);
+    }
+    phase_add(halo.times, PHASE_HALO, start);
+}
+
+void halo_free(HaloExchange &halo)
+{
+    for (int set = 0; set < HALO_PERSISTENT_SETS; ++set)
+    {
+        PersistentHalo &persistent = halo.persistent[set];
+        if (persistent.buffer != nullptr)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                MPI_Request_free(&persistent.requests[i]);
+            }
+            persistent.buffer = nullptr;
+        }
+    }
+    if (halo.mode == HALO_SHARED)
+    {
+        MPI_Win_unlock_all(halo.window);
+        MPI_Win_free(&halo.window);
+        MPI_Comm_free(&halo.node_comm);
+    }
+    else if (halo.mode == HALO_RMA)
+    {
+        MPI_Win_free(&halo.window);
+        MPI_Group_free(&halo.neighbours);
+    }
+}
+
+bool parse_halo_mode(const char *name, HaloMode &mode)
+{
+    if (std::strcmp(name, "blocking") == 0)
+    {
+        mode = HALO_BLOCKING;
+    }
+    else if (std::strcmp(name, "nonblocking") == 0)
+    {
+        mode = HALO_NONBLOCKING;
+    }
+    else if (std::strcmp(name, "persistent") == 0)
+    {
+        mode = HALO_PERSISTENT;
+    }
+    else if (std::strcmp(name, "shared") == 0)
+    {
+        mode = HALO_SHARED;
+    }
+    else if (std::strcmp(name, "rma") == 0)
+    {
+        mode = HALO_RMA;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char *halo_mode_name(HaloMode mode)
+{
+    if (mode == HALO_PERSISTENT)
+    {
+        return "persistent";
+    }
+    if (mode == HALO_SHARED)
+    {
+        return "shared";
+    }
+    if (mode == HALO_RMA)
+    {
+        return "rma";
+    }
+    return mode == HALO_NONBLOCKING ? "nonblocking" : "blocking";
+}
@@ -0,0 +1,83 @@
+#ifndef JACOBI_HALO_H
+#define JACOBI_HALO_H
+
+#include <cstddef> // For size_t
+#include <mpi.h>
+#include "timing.h"
+
+// How the ghost cells of a slab are refreshed every iteration.
+enum HaloMode
+{
+    HALO_BLOCKING,    // two MPI_Sendrecv calls, finished before any point is updated
+    HALO_NONBLOCKING, // MPI_Irecv/MPI_Isend left in flight while the interior is updated
+    HALO_PERSISTENT,  // like nonblocking, but requests made once and restarted with MPI_Startall
+    HALO_SHARED,      // neighbours on the same node read each other's boundary points from a
+                      // shared-memory window; only neighbours on other nodes get messages
+    HALO_RMA          // neighbours MPI_Put their boundary points into a window of ghost cells,
+                      // in post-start-complete-wait epochs limited to the two neighbours
+};
+
+// Persistent requests are tied to one buffer, and the solvers alternate between a few
+// buffers (the Jacobi ping-pong pair, the CG vectors), so a handful of request sets are kept
+#define HALO_PERSISTENT_SETS 4
+
+struct PersistentHalo
+{
+    const void *buffer; // nullptr while the set is unused
+    int size_per_process;
+    MPI_Datatype type;
+    MPI_Request requests[4];
+};
+
+// Everything needed to exchange the ghost cells of one slab with its ring neighbours.
+// The slab has `depth` ghost cells on each side, so its own points start at local[depth].
+// A point is `width` consecutive values (one per problem of a batch), so with a width above
+// one the indices above count points, not values, and a whole point travels in one message.
+struct HaloExchange
+{
+    HaloMode mode;
+    int depth;
+    int width;
+    MPI_Comm comm;
+    int left_process;
+    int right_process;
+    int message_tag;
+    MPI_Request requests[4];
+    PhaseTimes *times; // time and bytes of every exchange are added here, nullptr to not time
+    PersistentHalo persistent[HALO_PERSISTENT_SETS];
+    int next_persistent; // set to replace when a new buffer turns up
+    int active;          // set started by the last halo_start, -1 for requests[]
+    // Shared mode: every rank publishes its first and last `depth` points in its own segment
+    // of a window shared by the ranks of its node. Segments have two slots used in turn, after
+    // flags through which only the two neighbours synchronise.
+    // RMA mode: the segment is where the neighbours put the left and then the right ghost cells.
+    MPI_Comm node_comm;
+    MPI_Win window;
+    MPI_Group neighbours; // RMA mode only
+    // Ghost cells that halo_finish copies the neighbours' points into
+    void *left_ghost;
+    void *right_ghost;
+    size_t ghost_bytes;
+    char *segment;
+    char *left_segment;  // the left neighbour's segment, nullptr if it is on another node
+    char *right_segment;
+    long long exchanges; // shared mode: exchanges started so far
+};
+
+// Collective over comm in shared and RMA modes
+void halo_init(HaloExchange &halo, HaloMode mode, int depth, int width, int left_process, int right_process, MPI_Comm comm);
+// Starts refreshing the ghost cells local[0..depth-1] and local[depth+size_per_process..]
+// (scaled by width).
+// Until halo_finish returns, the first and last `depth` points of the slab must not be
+// modified and the ghost cells must not be read.
+void halo_start(HaloExchange &halo, float *local, int size_per_process);
+void halo_start(HaloExchange &halo, double *local, int size_per_process);
+void halo_finish(HaloExchange &halo);
+// Releases the persistent requests or the window (collectively). Needed before
+// MPI_Finalize in those modes.
+void halo_free(HaloExchange &halo);
+
+bool parse_halo_mode(const char *name, HaloMode &mode);
+const char *halo_mode_name(HaloMode mode);
+
+#endif
@@ -2,212 +2,808 @@
 #include <vector>
 #include <cmath>   // For std::abs
 #include <numeric> // For std::max
+#include <algorithm> // For std::swap
 #include <cstdlib> // For malloc, free
+#include <cstring> // For std::strcmp, std::strncmp
+#include <climits> // For INT_MAX
+#include <cstdint> // For int64_t
 #include <mpi.h>
+#include "jacobi.h"
+#include "cartesian.h"
+#include "batch.h"
+#include "convergence.h"
+#include "ring_io.h"
+#include "checkpoint.h"
+#include "thread_team.h"
+#include "step.h"
+#include "multigrid.h"
+#include "cg.h"
+#include "sor.h"
+#include "timing.h"
+#include "rebalance.h"
+#include "stencil_kernels.h"
+
+#define MAX_V_CYCLES 1000
 
 // Function declarations
-void read_problem(int &arr_size, float *&work);
-// Changed signature for print_results
-void print_results(int arr_size, const float *work);
-void do_one_step(float *local_data, float *local_error, int size_per_process);
+bool parse_options(int argc, char *argv[], SolverOptions &options);
+void print_usage(const char *program);
+void solve_jacobi(const SolverOptions &options, float *&local, float *&new_local, int &size_per_process,
+                  int64_t arr_size, std::vector<int64_t> &counts, std::vector<int64_t> &displs,
+                  int first_iteration, float restart_error, HaloExchange &halo, float acceptable_error,
+                  PhaseTimes *times);
+bool solve_multigrid(const SolverOptions &options, float *slab, int64_t arr_size,
+                     const std::vector<int64_t> &counts, const HaloExchange &halo, float acceptable_error,
+                     PhaseTimes *times);
+void solve_cg(const SolverOptions &options, float *slab, int size_per_process, HaloExchange &halo,
+              float acceptable_error, PhaseTimes *times);
+void solve_sor(const SolverOptions &options, float *local, int size_per_process, int64_t arr_size,
+               int64_t first_index, HaloExchange &halo, float acceptable_error, PhaseTimes *times);
+const char *solver_name(SolverKind solver);
 
 int main(int argc, char *argv[])
 {
     int num_of_processes;
     int rank;
-    int arr_size = 0; // Initialize arr_size
+    int64_t arr_size = 0; // Global indices are 64-bit, only slabs need to fit an int
     int orchestrator = 0;
-    float *work = nullptr; // Initialize work pointer
+    SolverOptions options;
 
-    MPI_Init(&argc, &argv);
+    // Only the main thread of a rank calls MPI; the others just update points
+    int thread_support;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
     MPI_Comm_size(MPI_COMM_WORLD, &num_of_processes);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    if (rank == orchestrator)
+    // Every rank sees the same argv, so every rank reaches the same verdict
+    if (!parse_options(argc, argv, options))
     {
-        // read_problem now correctly allocates work based on the size it sets
-        read_problem(arr_size, work);
-        std::cout << "Problem size: " << arr_size << std::endl;
-        std::cout << "Number of processes: " << num_of_processes << std::endl;
+        if (rank == orchestrator)
+        {
+            print_usage(argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
 
-        // Basic check for divisibility (optional but good practice)
-        if (arr_size % num_of_processes != 0)
+    if (options.threads > 1 && thread_support < MPI_THREAD_FUNNELED)
+    {
+        if (rank == orchestrator)
         {
-            std::cerr << "Error: Array size " << arr_size
-                      << " is not divisible by the number of processes "
-                      << num_of_processes << ". Exiting." << std::endl;
-            // Free allocated memory before aborting
-            delete[] work;
-            MPI_Abort(MPI_COMM_WORLD, 1);
+            std::cerr << "Error: The MPI library does not support threads (MPI_THREAD_FUNNELED). Exiting." << std::endl;
         }
+        MPI_Finalize();
+        return 1;
     }
 
-    // Broadcast the actual array size determined by rank 0
-    MPI_Bcast(&arr_size, 1, MPI_INT, orchestrator, MPI_COMM_WORLD);
+    // 2D/3D grids are decomposed over a Cartesian process grid instead of a ring of slabs
+    if (options.grid_dims > 1)
+    {
+        int exit_code = run_cartesian(options, MPI_COMM_WORLD);
+        MPI_Finalize();
+        return exit_code;
+    }
+    if (options.batch > 1)
+    {
+        int exit_code = run_batch(options, MPI_COMM_WORLD);
+        MPI_Finalize();
+        return exit_code;
+    }
 
-    // Ensure arr_size is positive and divisible before proceeding
-    if (arr_size <= 0 || arr_size % num_of_processes != 0)
+    arr_size = options.array_size;
+    std::string input_path = options.input_path;
+    int first_iteration = 0;
+    float restart_error = 0.0f;
+    if (options.restart)
     {
-        // Non-orchestrator ranks might hit this if orchestrator aborted
-        // Or if read_problem failed silently (though it shouldn't here)
-        if (rank != orchestrator)
+        // A checkpoint is an array file with a trailer, so it is read like --input
+        if (checkpoint_find_latest(options.checkpoint_prefix, MPI_COMM_WORLD, input_path,
+                                   arr_size, first_iteration, restart_error))
+        {
+            if (rank == orchestrator)
+            {
+                std::cout << "Resuming from " << input_path << " at iteration " << first_iteration << std::endl;
+            }
+        }
+        else if (rank == orchestrator)
         {
-            std::cerr << "Rank " << rank << " received invalid arr_size " << arr_size
-                      << " or non-divisible size. Exiting." << std::endl;
+            std::cout << "No complete checkpoint found for " << options.checkpoint_prefix
+                      << ", starting from the beginning" << std::endl;
         }
+    }
+    if (first_iteration == 0 && !input_path.empty() && !read_ring_size(input_path, 1, MPI_COMM_WORLD, arr_size))
+    {
+        MPI_Finalize();
+        return 1;
+    }
+    if (rank == orchestrator)
+    {
+        std::cout << "Problem size: " << arr_size << std::endl;
+        std::cout << "Number of processes: " << num_of_processes << std::endl;
+        std::cout << "Solver: " << solver_name(options.solver) << std::endl;
+        std::cout << "Halo exchange: " << halo_mode_name(options.halo_mode)
+                  << ", depth " << options.halo_depth << std::endl;
+        std::cout << "Convergence check: every " << options.check_interval << " iterations"
+                  << (options.async_check ? " (MPI_Iallreduce)" : "") << std::endl;
+        std::cout << "Threads per process: " << options.threads << std::endl;
+        std::cout << "Stencil kernels: " << stencil_isa() << std::endl;
+    }
+
+    int depth = options.halo_depth;
+    std::vector<int64_t> counts, displs;
+    if (!partition_ring(options, arr_size, depth, 1, MPI_COMM_WORLD, counts, displs))
+    {
         MPI_Finalize();
-        return 1; // Exit if size is invalid
+        return 1;
     }
 
-    int size_per_process = arr_size / num_of_processes;
-    // Allocate local buffer including ghost cells
-    float *local = (float *)malloc(sizeof(float) * (size_per_process + 2));
-    if (!local)
+    int size_per_process = (int)counts[rank];
+    // Allocate the local buffer and its update target, both including `depth` ghost cells
+    // on each side. Each step reads one and writes the other, then the pointers are swapped,
+    // so the iterations themselves never allocate or copy. The other solvers work in place
+    // or on their own vectors and only need the first.
+    float *local = (float *)malloc(sizeof(float) * (size_per_process + 2 * depth));
+    float *new_local = nullptr;
+    if (options.solver == SOLVER_JACOBI)
+    {
+        new_local = (float *)malloc(sizeof(float) * (size_per_process + 2 * depth));
+    }
+    if (!local || (options.solver == SOLVER_JACOBI && !new_local))
     {
-        std::cerr << "Rank " << rank << " failed to allocate memory for local buffer. Exiting." << std::endl;
+        std::cerr << "Rank " << rank << " failed to allocate memory for local buffers. Exiting." << std::endl;
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    // Scatter the data from work (on rank 0) to the local buffers (starting at index 1)
-    // Note: work pointer is only valid on rank 0 before Scatter
-    MPI_Scatter(work, size_per_process, MPI_FLOAT,
-                &local[1], size_per_process, MPI_FLOAT,
-                orchestrator, MPI_COMM_WORLD);
+    // Every rank fills its own slab, starting at index depth
+    if (!load_ring_slab(input_path, arr_size, 1, displs[rank], size_per_process, &local[depth], MPI_COMM_WORLD))
+    {
+        free(local);
+        free(new_local);
+        MPI_Finalize();
+        return 1;
+    }
 
     // Define neighbor ranks with wrap-around
     int left_process = (rank + num_of_processes - 1) % num_of_processes;
     int right_process = (rank + 1) % num_of_processes;
+    HaloExchange halo;
+    halo_init(halo, options.halo_mode, depth, 1, left_process, right_process, MPI_COMM_WORLD);
+    PhaseTimes times;
+    phase_times_init(times);
+    PhaseTimes *timer = options.timings_path.empty() ? nullptr : &times;
+    halo.times = timer;
+
+    float acceptable_error = 0.001f; // Use a smaller error for convergence
+    double solve_start = phase_clock(timer);
+    if (options.solver == SOLVER_MULTIGRID)
+    {
+        if (!solve_multigrid(options, &local[depth], arr_size, counts, halo, acceptable_error, timer))
+        {
+            halo_free(halo);
+            free(local);
+            free(new_local);
+            MPI_Finalize();
+            return 1;
+        }
+    }
+    else if (options.solver == SOLVER_CG || options.solver == SOLVER_PIPELINED_CG)
+    {
+        solve_cg(options, &local[depth], size_per_process, halo, acceptable_error, timer);
+    }
+    else if (options.solver == SOLVER_SOR)
+    {
+        solve_sor(options, local, size_per_process, arr_size, displs[rank], halo, acceptable_error, timer);
+    }
+    else
+    {
+        solve_jacobi(options, local, new_local, size_per_process, arr_size, counts, displs,
+                     first_iteration, restart_error, halo, acceptable_error, timer);
+    }
 
-    float acceptable_error = 0.001f;              // Use a smaller error for convergence
-    float global_error = acceptable_error + 1.0f; // Ensure loop runs at least once
-    float local_error;
-    MPI_Status status;
-    int message_tag = 0;
-    int iterations = 0; // Add iteration counter
+    if (timer)
+    {
+        times.solve_seconds = MPI_Wtime() - solve_start;
+    }
+    int exit_code = report_ring_results(options, solver_name(options.solver), timer, arr_size, 1, counts, displs,
+                                        &local[depth], MPI_COMM_WORLD);
+    halo_free(halo);
+    // Free the local buffers allocated with malloc
+    free(local);
+    free(new_local);
 
-    do
+    MPI_Finalize();
+
+    return exit_code;
+}
+
+// Runs Jacobi steps until the largest update drops below acceptable_error. The result is
+// left in local, with new_local as the spare buffer. With --rebalance the slabs may change
+// size; both buffers, size_per_process, counts and displs then describe the new split.
+void solve_jacobi(const SolverOptions &options, float *&local, float *&new_local, int &size_per_process,
+                  int64_t arr_size, std::vector<int64_t> &counts, std::vector<int64_t> &displs,
+                  int first_iteration, float restart_error, HaloExchange &halo, float acceptable_error,
+                  PhaseTimes *times)
+{
+    int rank;
+    int orchestrator = 0;
+    int depth = options.halo_depth;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Compute time is step time less halo time, so the halo is timed even without --timings
+    Rebalancer rebalancer;
+    PhaseTimes rebalance_times;
+    PhaseTimes *halo_times = halo.times;
+    bool rebalancing = options.rebalance_window > 0;
+    if (rebalancing)
     {
-        // Exchange ghost cells (boundary values) with neighbors
-        // Send local[1] (leftmost data) to left neighbor, receive into local[size_per_process + 1] (right ghost cell) from right neighbor
-        MPI_Sendrecv(&local[1], 1, MPI_FLOAT, left_process, message_tag,
-                     &local[size_per_process + 1], 1, MPI_FLOAT, right_process, message_tag,
-                     MPI_COMM_WORLD, &status);
+        rebalance_init(rebalancer, options.rebalance_window, options.rebalance_threshold, depth, MPI_COMM_WORLD);
+        rebalancer.times = times;
+        if (!halo.times)
+        {
+            phase_times_init(rebalance_times);
+            halo.times = &rebalance_times;
+        }
+    }
 
-        // Send local[size_per_process] (rightmost data) to right neighbor, receive into local[0] (left ghost cell) from left neighbor
-        MPI_Sendrecv(&local[size_per_process], 1, MPI_FLOAT, right_process, message_tag,
-                     &local[0], 1, MPI_FLOAT, left_process, message_tag,
-                     MPI_COMM_WORLD, &status);
+    // The team lives for the whole solve, so no thread is created inside the loop
+    ThreadTeam team;
+    if (!team_start(team, options.threads))
+    {
+        std::cerr << "Rank " << rank << " cannot create a barrier for its threads; set BARRIER to sense,"
+                  << " dissemination, tournament or condvar. Exiting." << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (team.barrier && rank == orchestrator)
+    {
+        std::cout << "Thread barrier: " << barrier_variant(team.barrier) << std::endl;
+    }
 
-        // Perform one step of the Jacobi calculation and compute local error
-        do_one_step(local, &local_error, size_per_process);
+    float local_error;
+    int iterations = first_iteration; // Add iteration counter
+    ConvergenceCheck check;
+    convergence_init(check, options.check_interval, options.async_check, acceptable_error, MPI_COMM_WORLD);
+    check.times = times;
+    if (first_iteration > 0)
+    {
+        check.global_error = restart_error;
+    }
+    Checkpoint checkpoint;
+    bool checkpointing = !options.checkpoint_prefix.empty();
+    if (checkpointing)
+    {
+        checkpoint_init(checkpoint, options.checkpoint_prefix, options.checkpoint_interval, first_iteration,
+                        arr_size, displs[rank], size_per_process, MPI_COMM_WORLD);
+    }
 
-        // Reduce the maximum error across all processes
-        MPI_Allreduce(&local_error, &global_error, 1, MPI_FLOAT, MPI_MAX, MPI_COMM_WORLD);
+    do
+    {
+        // Exchange ghost cells (boundary values) with neighbors once every `depth` steps,
+        // perform one step of the Jacobi calculation and compute local error.
+        // A restart always begins with an exchange, whatever step it resumes at.
+        int sweep = (iterations - first_iteration) % depth + 1;
+        double step_start = rebalancing ? MPI_Wtime() : 0.0;
+        double halo_seconds = rebalancing ? halo.times->seconds[PHASE_HALO] : 0.0;
+        if (sweep == 1)
+        {
+            do_one_step(local, new_local, &local_error, size_per_process, halo, team);
+        }
+        else
+        {
+            do_local_step(local, new_local, &local_error, size_per_process, depth, sweep, team);
+        }
+        std::swap(local, new_local);
 
         iterations++;
+        // Slabs only move right before an exchange, when no ghost cell is still being relied on
+        if (rebalancing)
+        {
+            halo_seconds = halo.times->seconds[PHASE_HALO] - halo_seconds;
+            rebalance_record(rebalancer, MPI_Wtime() - step_start - halo_seconds);
+            if (sweep == depth && rebalance_step(rebalancer, local, new_local, counts, displs))
+            {
+                size_per_process = (int)counts[rank];
+            }
+        }
+        // The slab's own points are valid after every step, so any iteration can be saved.
+        // Its error is this step's, which the checkpoint reduces when it completes.
+        if (checkpointing)
+        {
+            double checkpoint_start = phase_clock(times);
+            bool saved = checkpoint_step(checkpoint, iterations, local_error, &local[depth]);
+            phase_add(times, PHASE_CHECKPOINT, checkpoint_start);
+            if (!saved && rank == orchestrator)
+            {
+                std::cerr << "Warning: Failed to write the checkpoint of iteration " << iterations << std::endl;
+            }
+        }
         // Optional: Print progress occasionally
         // if (rank == orchestrator && iterations % 100 == 0) {
-        //     std::cout << "Iteration " << iterations << ", Global Error: " << global_error << std::endl;
+        //     std::cout << "Iteration " << iterations << ", Global Error: " << check.global_error << std::endl;
         // }
         if (iterations > 100000)
         { // Safety break for potential infinite loops
+            convergence_finish(check);
             if (rank == orchestrator)
             {
-                std::cout << "Warning: Exceeded max iterations. Error: " << global_error << std::endl;
+                std::cout << "Warning: Exceeded max iterations. Error: " << check.global_error << std::endl;
             }
             break;
         }
 
-    } while (global_error > acceptable_error);
+        // Reduce the maximum error across all processes, every check_interval iterations
+    } while (!convergence_record(check, iterations, local_error));
+    team_stop(team);
+    halo.times = halo_times;
 
-    // Gather the results (from index 1 of local buffers) back to work on rank 0
-    // Note: work pointer is only valid on rank 0 after Gather
-    MPI_Gather(&local[1], size_per_process, MPI_FLOAT,
-               work, size_per_process, MPI_FLOAT,
-               orchestrator, MPI_COMM_WORLD);
+    if (checkpointing)
+    {
+        double checkpoint_start = phase_clock(times);
+        if (!checkpoint_finish(checkpoint) && rank == orchestrator)
+        {
+            std::cerr << "Warning: Failed to complete the last checkpoint" << std::endl;
+        }
+        phase_add(times, PHASE_CHECKPOINT, checkpoint_start);
+    }
+    if (times)
+    {
+        times->iterations = iterations - first_iteration;
+    }
 
-    // Print results and clean up
     if (rank == orchestrator)
     {
-        std::cout << "Converged after " << iterations << " iterations with final error: " << global_error << std::endl;
-        // Pass arr_size to print_results
-        print_results(arr_size, work);
-        // Free the memory allocated in read_problem
-        delete[] work;
+        std::cout << "Converged after " << iterations << " iterations with final error: " << check.global_error << std::endl;
+        report_extra_iterations(check, iterations);
+        if (rebalancing)
+        {
+            std::cout << "Rebalanced " << rebalancer.rebalances << " times, last imbalance "
+                      << rebalancer.last_imbalance << ", now " << *std::min_element(counts.begin(), counts.end())
+                      << " to " << *std::max_element(counts.begin(), counts.end()) << " points per process" << std::endl;
+        }
     }
-    // Free the local buffer allocated with malloc
-    free(local);
-
-    MPI_Finalize();
-
-    return 0;
 }
 
-// Corrected read_problem
-void read_problem(int &arr_size, float *&work)
+// Solves the ring with multigrid V-cycles on slab, the points this rank owns. Returns false
+// if the slabs are too small for the ring to be coarsened enough.
+bool solve_multigrid(const SolverOptions &options, float *slab, int64_t arr_size,
+                     const std::vector<int64_t> &counts, const HaloExchange &halo, float acceptable_error,
+                     PhaseTimes *times)
 {
-    // Define the size FIRST
-    arr_size = 6; // Or read from file/input
-
-    // Allocate memory using the now defined size
-    work = new float[arr_size];
+    int rank;
+    int orchestrator = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    // Check if allocation was successful (good practice)
-    if (!work)
+    Multigrid mg;
+    if (!multigrid_init(mg, arr_size, counts, options.halo_mode, halo.left_process, halo.right_process, MPI_COMM_WORLD))
     {
-        std::cerr << "Error: Failed to allocate memory in read_problem. Exiting." << std::endl;
-        MPI_Abort(MPI_COMM_WORLD, 1);
-        return; // Should not be reached due to Abort
+        if (rank == orchestrator)
+        {
+            std::cerr << "Error: Multigrid cannot coarsen " << arr_size << " points on " << counts.size()
+                      << " processes far enough, as some slabs are too small; use fewer processes. Exiting." << std::endl;
+        }
+        multigrid_free(mg);
+        return false;
+    }
+    if (rank == orchestrator)
+    {
+        std::cout << "Multigrid levels: " << mg.levels.size() << ", coarsest with "
+                  << mg.levels.back().num_points << " points" << std::endl;
+        if (mg.levels.size() < 2)
+        {
+            std::cout << "Warning: The ring is too small to coarsen; every cycle solves it directly on rank 0" << std::endl;
+        }
+    }
+    mg.times = times;
+    for (size_t l = 0; l < mg.levels.size(); ++l)
+    {
+        mg.levels[l].halo.times = times;
     }
 
-    for (int i = 0; i < arr_size; ++i)
+    int cycles;
+    float error;
+    if (!multigrid_solve(mg, slab, acceptable_error, MAX_V_CYCLES, cycles, error) && rank == orchestrator)
+    {
+        std::cout << "Warning: Exceeded max V-cycles. Error: " << error << std::endl;
+    }
+    multigrid_free(mg);
+    if (times)
+    {
+        times->iterations = cycles;
+    }
+    if (rank == orchestrator)
     {
-        work[i] = (float)i * 20.0f; // Example initialization for smaller sizes
+        std::cout << "Converged after " << cycles << " V-cycles with final error: " << error << std::endl;
     }
+    return true;
 }
 
-// Corrected print_results
-void print_results(int arr_size, const float *work)
+// Solves the ring with conjugate gradients on slab, the points this rank owns. CG minimises
+// the error in the energy norm rather than stepping towards the answer, so convergence is
+// judged on the 2-norm of the residual instead of the size of the last update.
+void solve_cg(const SolverOptions &options, float *slab, int size_per_process, HaloExchange &halo,
+              float acceptable_error, PhaseTimes *times)
 {
-    std::cout << "Final Results:" << std::endl;
-    // Iterate up to arr_size
-    for (int i = 0; i < arr_size; ++i)
+    int rank;
+    int orchestrator = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int iterations;
+    double residual_norm;
+    if (!cg_solve(slab, size_per_process, halo, options.solver == SOLVER_PIPELINED_CG, acceptable_error,
+                  100000, iterations, residual_norm, times) &&
+        rank == orchestrator)
+    {
+        std::cout << "Warning: Exceeded max iterations. Residual norm: " << residual_norm << std::endl;
+    }
+    if (times)
     {
-        // Add formatting for better readability
-        std::cout << work[i] << (i == arr_size - 1 ? "" : " ");
+        times->iterations = iterations;
+    }
+    if (rank == orchestrator)
+    {
+        std::cout << "Converged after " << iterations << " iterations with residual norm: " << residual_norm << std::endl;
     }
-    std::cout << std::endl;
 }
 
-// do_one_step remains the same, but ensure correct headers included
-void do_one_step(float *local_data, float *local_error, int size_per_process)
+// Solves the ring with red-black SOR, in place in local. Like Jacobi it stops once no point
+// moves by acceptable_error in an iteration. Gauss-Seidel converges to a constant ring too,
+// but not the one Jacobi reaches, so the result is shifted back to the initial mean.
+void solve_sor(const SolverOptions &options, float *local, int size_per_process, int64_t arr_size,
+               int64_t first_index, HaloExchange &halo, float acceptable_error, PhaseTimes *times)
 {
-    float max_error = 0.0f;
-    // Use std::vector for automatic memory management and safety
-    std::vector<float> new_local(size_per_process + 2);
+    int rank;
+    int orchestrator = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    float omega = options.omega > 0.0f ? options.omega : sor_optimal_omega(arr_size);
+    if (rank == orchestrator)
+    {
+        std::cout << "SOR omega: " << omega << std::endl;
+    }
+
+    double local_sum = 0.0;
+    double initial_sum;
+    for (int i = 1; i <= size_per_process; ++i)
+    {
+        local_sum += local[i];
+    }
+    double start = phase_clock(times);
+    MPI_Allreduce(&local_sum, &initial_sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    phase_add(times, PHASE_REDUCE, start);
 
-    // Copy ghost cells to new_local to avoid using uninitialized values
-    // Though they are not directly used in the loop below, it's cleaner
-    // if new_local is meant to represent the full state including ghosts.
-    // Alternatively, size the vector to just size_per_process and adjust indexing.
-    new_local[0] = local_data[0];
-    new_local[size_per_process + 1] = local_data[size_per_process + 1];
+    float local_error;
+    int iterations = 0;
+    ConvergenceCheck check;
+    convergence_init(check, options.check_interval, options.async_check, acceptable_error, MPI_COMM_WORLD);
+    check.times = times;
+    do
+    {
+        local_error = sor_step(local, size_per_process, first_index, omega, halo);
+        iterations++;
+        if (iterations > 100000)
+        {
+            convergence_finish(check);
+            if (rank == orchestrator)
+            {
+                std::cout << "Warning: Exceeded max iterations. Error: " << check.global_error << std::endl;
+            }
+            break;
+        }
+    } while (!convergence_record(check, iterations, local_error));
 
+    double final_sum;
+    local_sum = 0.0;
+    for (int i = 1; i <= size_per_process; ++i)
+    {
+        local_sum += local[i];
+    }
+    start = phase_clock(times);
+    MPI_Allreduce(&local_sum, &final_sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    phase_add(times, PHASE_REDUCE, start);
+    float shift = (float)((initial_sum - final_sum) / (double)arr_size);
+    if (times)
+    {
+        times->iterations = iterations;
+    }
     for (int i = 1; i <= size_per_process; ++i)
     {
-        // Jacobi update formula: average of the left and right neighbours from the *old* data
-        new_local[i] = 0.5f * (local_data[i - 1] + local_data[i + 1]);
+        local[i] += shift;
+    }
 
-        // Check the difference between the old value and the new value at the same index.
-        // std::abs is preferred over abs for floats (from <cmath>)
-        max_error = std::max(max_error, std::abs(new_local[i] - local_data[i]));
+    if (rank == orchestrator)
+    {
+        std::cout << "Converged after " << iterations << " iterations with final error: " << check.global_error << std::endl;
+        report_extra_iterations(check, iterations);
     }
+}
 
-    // Copy new values back to local_data's relevant portion
-    for (int i = 1; i <= size_per_process; ++i)
+const char *solver_name(SolverKind solver)
+{
+    if (solver == SOLVER_MULTIGRID)
+    {
+        return "multigrid";
+    }
+    if (solver == SOLVER_CG)
+    {
+        return "cg";
+    }
+    if (solver == SOLVER_SOR)
+    {
+        return "sor";
+    }
+    return solver == SOLVER_PIPELINED_CG ? "pipelined-cg" : "jacobi";
+}
+
+// Parses --option=value arguments; returns false on anything unrecognised
+bool parse_options(int argc, char *argv[], SolverOptions &options)
+{
+    options.array_size = 6;
+    options.checkpoint_interval = 10000;
+    options.restart = false;
+    options.solver = SOLVER_JACOBI;
+    options.omega = 0.0f;
+    options.halo_mode = HALO_BLOCKING;
+    options.grid_dims = 1;
+    options.halo_depth = 1;
+    options.check_interval = 1;
+    options.async_check = false;
+    options.threads = 1;
+    options.batch = 1;
+    options.rebalance_window = 0;
+    options.rebalance_threshold = 1.1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (std::strncmp(arg, "--size=", 7) == 0)
+        {
+            char *end;
+            long long size = std::strtoll(arg + 7, &end, 10);
+            if (*end != '\0' || size < 1)
+            {
+                return false;
+            }
+            options.array_size = (int64_t)size;
+        }
+        else if (std::strncmp(arg, "--input=", 8) == 0)
+        {
+            options.input_path = arg + 8;
+        }
+        else if (std::strncmp(arg, "--output=", 9) == 0)
+        {
+            options.output_path = arg + 9;
+        }
+        else if (std::strncmp(arg, "--timings=", 10) == 0)
+        {
+            options.timings_path = arg + 10;
+        }
+        else if (std::strncmp(arg, "--checkpoint=", 13) == 0)
+        {
+            options.checkpoint_prefix = arg + 13;
+        }
+        else if (std::strncmp(arg, "--checkpoint-interval=", 22) == 0)
+        {
+            char *end;
+            long interval = std::strtol(arg + 22, &end, 10);
+            if (*end != '\0' || interval < 1 || interval > INT_MAX)
+            {
+                return false;
+            }
+            options.checkpoint_interval = (int)interval;
+        }
+        else if (std::strcmp(arg, "--restart") == 0)
+        {
+            options.restart = true;
+        }
+        else if (std::strncmp(arg, "--weights=", 10) == 0)
+        {
+            // Comma-separated relative speeds, one per process
+            const char *value = arg + 10;
+            char *end;
+            options.weights.clear();
+            while (true)
+            {
+                double weight = std::strtod(value, &end);
+                if (end == value || !(weight > 0.0))
+                {
+                    return false;
+                }
+                options.weights.push_back(weight);
+                if (*end != ',')
+                {
+                    break;
+                }
+                value = end + 1;
+            }
+            if (*end != '\0')
+            {
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--solver=jacobi") == 0)
+        {
+            options.solver = SOLVER_JACOBI;
+        }
+        else if (std::strcmp(arg, "--solver=multigrid") == 0)
+        {
+            options.solver = SOLVER_MULTIGRID;
+        }
+        else if (std::strcmp(arg, "--solver=cg") == 0)
+        {
+            options.solver = SOLVER_CG;
+        }
+        else if (std::strcmp(arg, "--solver=pipelined-cg") == 0)
+        {
+            options.solver = SOLVER_PIPELINED_CG;
+        }
+        else if (std::strcmp(arg, "--solver=sor") == 0)
+        {
+            options.solver = SOLVER_SOR;
+        }
+        else if (std::strncmp(arg, "--omega=", 8) == 0)
+        {
+            char *end;
+            double omega = std::strtod(arg + 8, &end);
+            if (*end != '\0' || !(omega > 0.0 && omega < 2.0))
+            {
+                return false;
+            }
+            options.omega = (float)omega;
+        }
+        else if (std::strncmp(arg, "--halo=", 7) == 0)
+        {
+            if (!parse_halo_mode(arg + 7, options.halo_mode))
+            {
+                return false;
+            }
+        }
+        else if (std::strncmp(arg, "--halo-depth=", 13) == 0)
+        {
+            char *end;
+            long depth = std::strtol(arg + 13, &end, 10);
+            if (*end != '\0' || depth < 1 || depth > 100000)
+            {
+                return false;
+            }
+            options.halo_depth = (int)depth;
+        }
+        else if (std::strncmp(arg, "--check-interval=", 17) == 0)
+        {
+            char *end;
+            long interval = std::strtol(arg + 17, &end, 10);
+            if (*end != '\0' || interval < 1 || interval > 100000)
+            {
+                return false;
+            }
+            options.check_interval = (int)interval;
+        }
+        else if (std::strcmp(arg, "--async-check") == 0)
+        {
+            options.async_check = true;
+        }
+        else if (std::strncmp(arg, "--threads=", 10) == 0)
+        {
+            char *end;
+            long threads = std::strtol(arg + 10, &end, 10);
+            if (*end != '\0' || threads < 1 || threads > 1024)
+            {
+                return false;
+            }
+            options.threads = (int)threads;
+        }
+        else if (std::strncmp(arg, "--rebalance=", 12) == 0)
+        {
+            char *end;
+            long window = std::strtol(arg + 12, &end, 10);
+            if (*end != '\0' || window < 0 || window > INT_MAX)
+            {
+                return false;
+            }
+            options.rebalance_window = (int)window;
+        }
+        else if (std::strncmp(arg, "--rebalance-threshold=", 22) == 0)
+        {
+            char *end;
+            double threshold = std::strtod(arg + 22, &end);
+            if (*end != '\0' || !(threshold >= 1.0))
+            {
+                return false;
+            }
+            options.rebalance_threshold = threshold;
+        }
+        else if (std::strncmp(arg, "--batch=", 8) == 0)
+        {
+            char *end;
+            long batch = std::strtol(arg + 8, &end, 10);
+            if (*end != '\0' || batch < 1 || batch > INT_MAX)
+            {
+                return false;
+            }
+            options.batch = (int)batch;
+        }
+        else if (std::strncmp(arg, "--grid=", 7) == 0)
+        {
+            // Comma-separated point counts, one per dimension
+            const char *value = arg + 7;
+            char *end;
+            options.grid_dims = 0;
+            while (options.grid_dims < MAX_GRID_DIMS)
+            {
+                long points = std::strtol(value, &end, 10);
+                if (end == value || points < 1 || points > INT_MAX)
+                {
+                    return false;
+                }
+                options.grid_size[options.grid_dims++] = (int)points;
+                if (*end != ',')
+                {
+                    break;
+                }
+                value = end + 1;
+            }
+            if (*end != '\0' || options.grid_dims < 2)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Deep halos, checkpoints, threads, window-based halos, timings, weights and array files are only
+    // implemented for the 1D ring; the Cartesian blocks always use the even split
+    if (options.grid_dims > 1 && (options.halo_depth > 1 || !options.checkpoint_prefix.empty() || options.threads > 1 ||
+                                  options.halo_mode == HALO_SHARED || options.halo_mode == HALO_RMA ||
+                                  !options.timings_path.empty() || !options.weights.empty() ||
+                                  !options.input_path.empty() || !options.output_path.empty()))
+    {
+        return false;
+    }
+    // The other solvers keep one ghost cell (or their own vectors), and a restart would lose their state
+    if (options.solver != SOLVER_JACOBI &&
+        (options.grid_dims > 1 || options.halo_depth > 1 || !options.checkpoint_prefix.empty() || options.threads > 1))
+    {
+        return false;
+    }
+    // A batch is stepped in lockstep and checked every iteration, one problem at a time
+    if (options.batch > 1 &&
+        (options.solver != SOLVER_JACOBI || options.grid_dims > 1 || options.halo_depth > 1 ||
+         options.check_interval > 1 || options.async_check || !options.checkpoint_prefix.empty() || options.threads > 1))
+    {
+        return false;
+    }
+    // Checkpoints are written by fixed slabs, and only the Jacobi solver's ring is rebalanced
+    if (options.rebalance_window > 0 &&
+        (options.solver != SOLVER_JACOBI || options.grid_dims > 1 || options.batch > 1 ||
+         !options.checkpoint_prefix.empty()))
     {
-        local_data[i] = new_local[i];
+        return false;
     }
+    return !options.restart || !options.checkpoint_prefix.empty();
+}
 
-    *local_error = max_error;
-}
\ No newline at end of file
+void print_usage(const char *program)
+{
+    std::cerr << "Usage: mpirun -np <processes> " << program << " [options]" << std::endl;
+    std::cerr << "  --size=N                     number of points in the ring (default 6)" << std::endl;
+    std::cerr << "  --input=FILE                 read the initial ring from an array file (overrides --size, 1D ring only)" << std::endl;
+    std::cerr << "  --output=FILE                write the result to an array file instead of printing it (1D ring only)" << std::endl;
+    std::cerr << "  --timings=FILE               write per-phase times and traffic of every rank as JSON" << std::endl;
+    std::cerr << "  --checkpoint=PREFIX          save the ring to PREFIX.0/PREFIX.1 in turn while solving" << std::endl;
+    std::cerr << "  --checkpoint-interval=N      iterations between checkpoints (default 10000)" << std::endl;
+    std::cerr << "  --restart                    resume from the newest complete checkpoint of PREFIX" << std::endl;
+    std::cerr << "  --solver=NAME                jacobi (default), multigrid, cg, pipelined-cg or sor (1D ring only)" << std::endl;
+    std::cerr << "  --omega=W                    SOR over-relaxation factor, 0 < W < 2 (default optimal for the size)" << std::endl;
+    std::cerr << "  --weights=W0,W1,...          relative slab size of every process (default equal, 1D ring only)" << std::endl;
+    std::cerr << "  --halo=MODE                  ghost cell exchange: blocking (default), nonblocking, persistent," << std::endl;
+    std::cerr << "                               shared or rma; all but blocking overlap it with the interior update" << std::endl;
+    std::cerr << "  --halo-depth=K               exchange K ghost cells once every K steps (1D ring only)" << std::endl;
+    std::cerr << "  --check-interval=K           reduce the error every K iterations (default 1)" << std::endl;
+    std::cerr << "  --async-check                overlap that reduction (MPI_Iallreduce) with the next K sweeps" << std::endl;
+    std::cerr << "  --threads=T                  threads updating each process's slab (1D ring only)" << std::endl;
+    std::cerr << "  --rebalance=W                every W steps, move slab boundaries towards equal compute time" << std::endl;
+    std::cerr << "  --rebalance-threshold=R      only if the slowest rank exceeds R times the mean (default 1.1)" << std::endl;
+    std::cerr << "  --batch=B                    solve B independent rings of the same size together (Jacobi only)" << std::endl;
+    std::cerr << "  --grid=NX,NY[,NZ]            solve a 2D/3D grid with fixed boundaries on a Cartesian" << std::endl;
+    std::cerr << "                               process grid instead of the 1D ring" << std::endl;
+}
@@ -0,0 +1,48 @@
+#ifndef JACOBI_H
+#define JACOBI_H
+
+#include <vector>
+#include <string>
+#include <cstdint> // For int64_t
+#include "halo.h"
+
+#define MAX_GRID_DIMS 3
+// Larger results are only summarised, so rank 0 never has to hold a production-size array
+#define MAX_PRINTED_POINTS 1000000
+
+// Method used to solve the 1D ring
+enum SolverKind
+{
+    SOLVER_JACOBI,       // plain Jacobi steps
+    SOLVER_MULTIGRID,    // V-cycles with a damped Jacobi smoother
+    SOLVER_CG,           // conjugate gradients, one blocking reduction per iteration
+    SOLVER_PIPELINED_CG, // conjugate gradients with the reduction overlapping the matrix-vector product
+    SOLVER_SOR           // red-black successive over-relaxation, in place
+};
+
+// Run-time configuration, read from the command line on every rank
+struct SolverOptions
+{
+    int64_t array_size;             // points in the 1D ring
+    std::string input_path;         // array file with the initial ring, empty to generate it
+    std::string output_path;        // array file for the result, empty to print it
+    std::string checkpoint_prefix;  // checkpoint files are <prefix>.0 and <prefix>.1, empty for none
+    std::string timings_path;       // JSON file for per-phase timings, empty to not time
+    int checkpoint_interval;        // iterations between checkpoints
+    bool restart;                   // resume from the newest checkpoint
+    std::vector<double> weights;    // relative slab size per process, empty for an even split
+    SolverKind solver;
+    float omega;                    // SOR over-relaxation factor, 0 to pick the optimum
+    HaloMode halo_mode;
+    int halo_depth;                 // ghost cells per side, exchanged once every halo_depth steps
+    int check_interval;             // iterations between global error reductions
+    bool async_check;               // overlap the reduction with the next check_interval sweeps
+    int grid_dims;                  // 1 for the ring problem, 2 or 3 for a Cartesian grid
+    int grid_size[MAX_GRID_DIMS];   // global points per dimension when grid_dims > 1
+    int threads;                    // threads updating each slab (1D ring only)
+    int batch;                      // independent rings of array_size points solved together
+    int rebalance_window;           // steps between load balance checks, 0 for a fixed split
+    double rebalance_threshold;     // max / mean compute time that triggers moving slab boundaries
+};
+
+#endif
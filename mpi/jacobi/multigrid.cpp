@@ -0,0 +1,405 @@
+#include <cmath>     // For std::abs
+#include <algorithm> // For std::max, std::fill
+#include "multigrid.h"
+
+// Levels at or below this many points are gathered rather than coarsened further, since
+// their messages cost more than the few points they update
+#define COARSE_POINTS 256
+// Larger coarsest levels must be at most this fraction of the ring, so that gathering one
+// every cycle costs far less than the cycle itself
+#define MIN_COARSENING 8
+#define PRE_SMOOTHING_STEPS 2
+#define POST_SMOOTHING_STEPS 2
+// Damped Jacobi with weight 2/3 removes the oscillating half of the error fastest, and unlike
+// plain Jacobi it also damps the mode that flips sign every step on an even ring
+#define SMOOTHER_WEIGHT (2.0 / 3.0)
+
+void add_level(Multigrid &mg, int64_t num_points, int64_t first_index, int count,
+               HaloMode mode, int left_process, int right_process);
+void coarsen_conductances(MultigridLevel &fine, MultigridLevel &coarse);
+bool carries_over(const MultigridLevel &level, int i);
+int coarse_index(const MultigridLevel &coarse, int64_t global);
+void v_cycle(Multigrid &mg, size_t l);
+void smooth(MultigridLevel &level);
+void smooth_points(MultigridLevel &level, int first, int last);
+double compute_residual(MultigridLevel &level);
+void restrict_residual(const MultigridLevel &fine, MultigridLevel &coarse);
+void prolong_correction(MultigridLevel &coarse, MultigridLevel &fine);
+void solve_coarsest(Multigrid &mg);
+void solve_ring(const std::vector<double> &c, const std::vector<double> &r, std::vector<double> &e);
+
+bool multigrid_init(Multigrid &mg, int64_t num_points, const std::vector<int64_t> &counts,
+                    HaloMode mode, int left_process, int right_process, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    mg.comm = comm;
+    mg.levels.clear();
+    mg.times = nullptr;
+
+    // Every rank sees the same counts, so every rank builds the same hierarchy. Coarse point
+    // j is fine point 2j, so a slab's coarse points are the even global indices it owns,
+    // whatever the parity of its size and first index.
+    int64_t ring_points = num_points;
+    std::vector<int64_t> level_counts(counts);
+    std::vector<int64_t> level_displs(counts.size(), 0);
+    for (size_t p = 1; p < counts.size(); ++p)
+    {
+        level_displs[p] = level_displs[p - 1] + counts[p - 1];
+    }
+    add_level(mg, num_points, level_displs[rank], (int)level_counts[rank], mode, left_process, right_process);
+    std::fill(mg.levels[0].c.begin(), mg.levels[0].c.end(), 1.0);
+    while (num_points > COARSE_POINTS)
+    {
+        // Coarsening stops once some rank would be left without a point
+        std::vector<int64_t> coarse_counts(level_counts.size());
+        std::vector<int64_t> coarse_displs(level_counts.size());
+        bool every_rank_keeps_a_point = true;
+        for (size_t p = 0; p < level_counts.size(); ++p)
+        {
+            coarse_displs[p] = (level_displs[p] + 1) / 2;
+            coarse_counts[p] = (level_displs[p] + level_counts[p] + 1) / 2 - coarse_displs[p];
+            every_rank_keeps_a_point = every_rank_keeps_a_point && coarse_counts[p] > 0;
+        }
+        if (!every_rank_keeps_a_point)
+        {
+            break;
+        }
+        level_counts.swap(coarse_counts);
+        level_displs.swap(coarse_displs);
+        num_points = (num_points + 1) / 2;
+        add_level(mg, num_points, level_displs[rank], (int)level_counts[rank], mode, left_process, right_process);
+        coarsen_conductances(mg.levels[mg.levels.size() - 2], mg.levels.back());
+    }
+
+    if (num_points > COARSE_POINTS && num_points > ring_points / MIN_COARSENING)
+    {
+        return false;
+    }
+    MultigridLevel &coarsest = mg.levels.back();
+    mg.coarse_counts.assign(level_counts.begin(), level_counts.end());
+    mg.coarse_displs.assign(level_displs.begin(), level_displs.end());
+    if (rank == 0)
+    {
+        mg.coarse_c.assign(num_points, 0.0);
+        mg.coarse_r.assign(num_points, 0.0);
+        mg.coarse_e.assign(num_points, 0.0);
+    }
+    // The coarsest operator never changes, so it is gathered once
+    MPI_Gatherv(&coarsest.c[1], coarsest.count, MPI_DOUBLE,
+                mg.coarse_c.data(), mg.coarse_counts.data(), mg.coarse_displs.data(), MPI_DOUBLE,
+                0, comm);
+    return true;
+}
+
+bool multigrid_solve(Multigrid &mg, float *slab, float acceptable_error, int max_cycles, int &cycles, float &error)
+{
+    MultigridLevel &finest = mg.levels[0];
+    for (int i = 0; i < finest.count; ++i)
+    {
+        finest.x[i + 1] = slab[i];
+    }
+
+    cycles = 0;
+    bool converged = false;
+    while (true)
+    {
+        // A Jacobi step would move each point by half its residual, so this is the same
+        // error the Jacobi solver reports
+        double local_error = 0.5 * compute_residual(finest);
+        double global_error;
+        double start = phase_clock(mg.times);
+        MPI_Allreduce(&local_error, &global_error, 1, MPI_DOUBLE, MPI_MAX, mg.comm);
+        phase_add(mg.times, PHASE_REDUCE, start);
+        error = (float)global_error;
+        if (global_error < acceptable_error)
+        {
+            converged = true;
+            break;
+        }
+        if (cycles == max_cycles)
+        {
+            break;
+        }
+        v_cycle(mg, 0);
+        cycles++;
+    }
+
+    for (int i = 0; i < finest.count; ++i)
+    {
+        slab[i] = (float)finest.x[i + 1];
+    }
+    return converged;
+}
+
+void multigrid_free(Multigrid &mg)
+{
+    for (size_t l = 0; l < mg.levels.size(); ++l)
+    {
+        halo_free(mg.levels[l].halo);
+    }
+    mg.levels.clear();
+}
+
+// Appends a level for the given slab of a ring of num_points, its conductances still unset
+void add_level(Multigrid &mg, int64_t num_points, int64_t first_index, int count,
+               HaloMode mode, int left_process, int right_process)
+{
+    MultigridLevel level;
+    level.num_points = num_points;
+    level.first_index = first_index;
+    level.count = count;
+    halo_init(level.halo, mode, 1, 1, left_process, right_process, mg.comm);
+    level.x.assign(count + 2, 0.0);
+    level.r.assign(count + 2, 0.0);
+    if (!mg.levels.empty())
+    {
+        level.f.assign(count + 2, 0.0);
+    }
+    level.c.assign(count + 2, 0.0);
+    level.left_weight.assign(count + 2, 0.0);
+    level.right_weight.assign(count + 2, 0.0);
+    mg.levels.push_back(level);
+}
+
+// Sets the interpolation weights of the fine level and the conductances of the coarse one.
+// Eliminating a point between two coarse points leaves the edges on either side of it in
+// series, so the coarse edge gets c1 c2 / (c1 + c2). With these weights, and restriction as
+// their transpose, that is exactly the Galerkin coarse operator.
+void coarsen_conductances(MultigridLevel &fine, MultigridLevel &coarse)
+{
+    for (int i = 1; i <= fine.count; ++i)
+    {
+        if (!carries_over(fine, i))
+        {
+            double sum = fine.c[i - 1] + fine.c[i];
+            fine.left_weight[i] = fine.c[i - 1] / sum;
+            fine.right_weight[i] = fine.c[i] / sum;
+        }
+    }
+    // Restriction reads the weights one point left and right of the slab
+    halo_start(fine.halo, fine.left_weight.data(), fine.count);
+    halo_finish(fine.halo);
+    halo_start(fine.halo, fine.right_weight.data(), fine.count);
+    halo_finish(fine.halo);
+
+    for (int i = 1; i <= fine.count; ++i)
+    {
+        if (carries_over(fine, i))
+        {
+            int j = coarse_index(coarse, fine.first_index + i - 1);
+            coarse.c[j] = carries_over(fine, i + 1)
+                              ? fine.c[i]
+                              : fine.c[i] * fine.c[i + 1] / (fine.c[i] + fine.c[i + 1]);
+        }
+    }
+    // The points at either end of the slab also need the neighbours' edges
+    halo_start(coarse.halo, coarse.c.data(), coarse.count);
+    halo_finish(coarse.halo);
+}
+
+// Whether local point i (0 and count + 1 being the ghost cells) has an even global index,
+// and so is also a point of the next level. On an odd ring the last point and point 0 are
+// both kept, so the coarse ring has one edge that spans a single fine edge.
+bool carries_over(const MultigridLevel &level, int i)
+{
+    int64_t global = (level.first_index + i - 1 + level.num_points) % level.num_points;
+    return global % 2 == 0;
+}
+
+// Local index, on this rank's coarse slab, of the coarse point at even fine index global.
+// Fine indices just past either end of the ring land on the ghost cells, which hold the
+// coarse points across the wrap-around.
+int coarse_index(const MultigridLevel &coarse, int64_t global)
+{
+    return (int)(global / 2 - coarse.first_index) + 1;
+}
+
+// Smooths level l, solves for the remaining smooth error on level l + 1 and adds it back
+void v_cycle(Multigrid &mg, size_t l)
+{
+    MultigridLevel &level = mg.levels[l];
+    if (l + 1 == mg.levels.size())
+    {
+        solve_coarsest(mg);
+        return;
+    }
+    MultigridLevel &coarse = mg.levels[l + 1];
+
+    for (int s = 0; s < PRE_SMOOTHING_STEPS; ++s)
+    {
+        smooth(level);
+    }
+    compute_residual(level);
+    restrict_residual(level, coarse);
+    std::fill(coarse.x.begin(), coarse.x.end(), 0.0);
+
+    v_cycle(mg, l + 1);
+
+    prolong_correction(coarse, level);
+    for (int s = 0; s < POST_SMOOTHING_STEPS; ++s)
+    {
+        smooth(level);
+    }
+}
+
+// One damped Jacobi step, with the interior updated while the ghost cells are in flight as
+// in do_one_step. The points themselves are not updated with do_one_step's kernels: those
+// are single precision and unweighted, while the levels are double precision and the coarse
+// ones weight each neighbour by its edge's conductance.
+void smooth(MultigridLevel &level)
+{
+    halo_start(level.halo, level.x.data(), level.count);
+    smooth_points(level, 2, level.count - 1);
+    halo_finish(level.halo);
+    smooth_points(level, 1, 1);
+    if (level.count > 1)
+    {
+        smooth_points(level, level.count, level.count);
+    }
+    std::swap(level.x, level.r);
+}
+
+void smooth_points(MultigridLevel &level, int first, int last)
+{
+    const double *x = level.x.data();
+    const double *c = level.c.data();
+    double *new_x = level.r.data();
+    for (int i = first; i <= last; ++i)
+    {
+        double rhs = level.f.empty() ? 0.0 : level.f[i];
+        double jacobi = (c[i - 1] * x[i - 1] + c[i] * x[i + 1] + rhs) / (c[i - 1] + c[i]);
+        new_x[i] = (1.0 - SMOOTHER_WEIGHT) * x[i] + SMOOTHER_WEIGHT * jacobi;
+    }
+}
+
+// Writes f - A x into level.r, ghost cells included, and returns its
+// largest magnitude over the points this rank owns
+double compute_residual(MultigridLevel &level)
+{
+    const double *x = level.x.data();
+    const double *c = level.c.data();
+    double *r = level.r.data();
+    double max_residual = 0.0;
+
+    halo_start(level.halo, level.x.data(), level.count);
+    halo_finish(level.halo);
+    for (int i = 1; i <= level.count; ++i)
+    {
+        double rhs = level.f.empty() ? 0.0 : level.f[i];
+        r[i] = rhs - (c[i - 1] * (x[i] - x[i - 1]) + c[i] * (x[i] - x[i + 1]));
+        max_residual = std::max(max_residual, std::abs(r[i]));
+    }
+    // Restriction reads the residual one point left and right of the slab
+    halo_start(level.halo, level.r.data(), level.count);
+    halo_finish(level.halo);
+    return max_residual;
+}
+
+// Restriction is the transpose of the interpolation: a coarse point collects its own
+// residual and the weighted residuals of the eliminated points next to it. On level 0 the
+// weights are those of full weighting, (1/2 1 1/2).
+void restrict_residual(const MultigridLevel &fine, MultigridLevel &coarse)
+{
+    const double *r = fine.r.data();
+    for (int i = 1; i <= fine.count; ++i)
+    {
+        if (carries_over(fine, i))
+        {
+            double sum = r[i];
+            if (!carries_over(fine, i - 1))
+            {
+                sum += fine.right_weight[i - 1] * r[i - 1];
+            }
+            if (!carries_over(fine, i + 1))
+            {
+                sum += fine.left_weight[i + 1] * r[i + 1];
+            }
+            coarse.f[coarse_index(coarse, fine.first_index + i - 1)] = sum;
+        }
+    }
+}
+
+// Coarse points carry over, the points between them take the weighted average of their two
+// coarse neighbours (the plain average on level 0)
+void prolong_correction(MultigridLevel &coarse, MultigridLevel &fine)
+{
+    const double *e = coarse.x.data();
+    double *x = fine.x.data();
+
+    halo_start(coarse.halo, coarse.x.data(), coarse.count);
+    halo_finish(coarse.halo);
+    for (int i = 1; i <= fine.count; ++i)
+    {
+        int64_t global = fine.first_index + i - 1;
+        if (carries_over(fine, i))
+        {
+            x[i] += e[coarse_index(coarse, global)];
+        }
+        else
+        {
+            int left = coarse_index(coarse, global - 1);
+            x[i] += fine.left_weight[i] * e[left] + fine.right_weight[i] * e[left + 1];
+        }
+    }
+}
+
+// Gathers the residual of the coarsest level onto rank 0, solves for the correction exactly
+// and hands every rank its part back
+void solve_coarsest(Multigrid &mg)
+{
+    MultigridLevel &level = mg.levels.back();
+    int rank;
+    MPI_Comm_rank(mg.comm, &rank);
+
+    compute_residual(level);
+    double start = phase_clock(mg.times);
+    MPI_Gatherv(&level.r[1], level.count, MPI_DOUBLE,
+                mg.coarse_r.data(), mg.coarse_counts.data(), mg.coarse_displs.data(), MPI_DOUBLE,
+                0, mg.comm);
+    if (rank == 0)
+    {
+        solve_ring(mg.coarse_c, mg.coarse_r, mg.coarse_e);
+    }
+    MPI_Scatterv(mg.coarse_e.data(), mg.coarse_counts.data(), mg.coarse_displs.data(), MPI_DOUBLE,
+                 &level.r[1], level.count, MPI_DOUBLE, 0, mg.comm);
+    // Rank 0's direct solve is counted as its wait, like any imbalance in a reduction
+    phase_add(mg.times, PHASE_REDUCE, start);
+    for (int i = 1; i <= level.count; ++i)
+    {
+        level.x[i] += level.r[i];
+    }
+}
+
+// Solves c[i-1] (e[i] - e[i-1]) + c[i] (e[i] - e[i+1]) = r[i] on a ring in O(n). The flux
+// q[i] = c[i] (e[i] - e[i+1]) through edge i satisfies q[i] = q[i-1] + r[i], and the drops
+// q[i] / c[i] sum to zero around the ring, which fixes q[0]. The operator leaves constants
+// unchanged, so the zero-mean solution is returned; that keeps the mean of the ring, which
+// the Jacobi iteration also preserves.
+void solve_ring(const std::vector<double> &c, const std::vector<double> &r, std::vector<double> &e)
+{
+    size_t n = r.size();
+    double partial = 0.0;      // r[1] + ... + r[i]
+    double weighted_sum = 0.0; // sum of partial / c[i]
+    double resistance = 1.0 / c[0];
+    for (size_t i = 1; i < n; ++i)
+    {
+        partial += r[i];
+        weighted_sum += partial / c[i];
+        resistance += 1.0 / c[i];
+    }
+    double q = -weighted_sum / resistance;
+    double mean = 0.0;
+    e[0] = 0.0;
+    for (size_t i = 1; i < n; ++i)
+    {
+        e[i] = e[i - 1] - q / c[i - 1];
+        q += r[i];
+        mean += e[i];
+    }
+    mean /= n;
+    for (size_t i = 0; i < n; ++i)
+    {
+        e[i] -= mean;
+    }
+}
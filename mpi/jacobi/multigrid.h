@@ -0,0 +1,57 @@
+#ifndef JACOBI_MULTIGRID_H
+#define JACOBI_MULTIGRID_H
+
+#include <vector>
+#include <cstdint> // For int64_t
+#include <mpi.h>
+#include "halo.h"
+#include "timing.h"
+
+// One grid of the hierarchy. Level 0 is the ring itself and every coarser level keeps the
+// points with an even global index on the level above it, so an odd ring coarsens too. Each
+// edge of a level has a conductance: the operator is (A x)[i] = c[i-1] (x[i] - x[i-1]) +
+// c[i] (x[i] - x[i+1]), with every c 1 on level 0. Arrays hold `count` points plus one ghost
+// cell per side.
+struct MultigridLevel
+{
+    int64_t num_points;  // points in the whole ring at this level
+    int64_t first_index; // global index of this rank's first point
+    int count;           // points owned by this rank
+    HaloExchange halo;
+    std::vector<double> x; // solution on level 0, correction on coarser levels
+    std::vector<double> f; // right-hand side; empty on level 0, whose right-hand side is zero
+    std::vector<double> r; // residual, also the smoother's update target
+    std::vector<double> c; // c[i] couples point i to point i + 1
+    // Interpolation weights of a point with an odd global index from the coarse points to its
+    // left and right; unused for the points that carry over to the next level
+    std::vector<double> left_weight;
+    std::vector<double> right_weight;
+};
+
+// A V-cycle hierarchy for the ring. The ring is coarsened for as long as every rank keeps
+// at least one point of the coarser level. The coarsest level is gathered onto one rank
+// and solved directly.
+struct Multigrid
+{
+    MPI_Comm comm;
+    std::vector<MultigridLevel> levels;
+    std::vector<int> coarse_counts; // slab sizes of the coarsest level, to gather it
+    std::vector<int> coarse_displs;
+    std::vector<double> coarse_c;   // the coarsest level's conductances, residual and correction,
+    std::vector<double> coarse_r;   // on rank 0 only
+    std::vector<double> coarse_e;
+    PhaseTimes *times;              // time of the collectives is added here, nullptr to not time
+};
+
+// Builds the hierarchy for a ring of num_points split into counts (one per rank). Returns
+// false on every rank if the slabs are too small to coarsen the ring to an eighth of its
+// size, in which case the coarsest level would be too large to gather onto one rank.
+bool multigrid_init(Multigrid &mg, int64_t num_points, const std::vector<int64_t> &counts,
+                    HaloMode mode, int left_process, int right_process, MPI_Comm comm);
+// Runs V-cycles on the slab until no point would move by acceptable_error or more in a
+// Jacobi step, or until max_cycles. Returns whether it converged; the cycle count and the
+// final error are returned through cycles and error.
+bool multigrid_solve(Multigrid &mg, float *slab, float acceptable_error, int max_cycles, int &cycles, float &error);
+void multigrid_free(Multigrid &mg);
+
+#endif
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <algorithm> // For std::max, std::min, std::max_element
+#include <climits>   // For INT_MAX
+#include <cstdlib>   // For malloc, free
+#include <cstring>   // For std::memcpy
+#include "rebalance.h"
+#include "decomposition.h"
+
+// Distinct tags for the two directions, as in the halo exchange, for rings of two ranks
+#define TAG_MIGRATE_LEFT 100
+#define TAG_MIGRATE_RIGHT 101
+
+bool limit_moves(const Rebalancer &rebalancer, const std::vector<int64_t> &counts, const std::vector<int64_t> &displs,
+                 std::vector<int64_t> &new_counts, std::vector<int64_t> &new_displs);
+void migrate(float *local, float *new_slab, int depth, int rank, int num_of_processes,
+             const std::vector<int64_t> &counts, const std::vector<int64_t> &displs,
+             const std::vector<int64_t> &new_counts, const std::vector<int64_t> &new_displs, MPI_Comm comm);
+
+void rebalance_init(Rebalancer &rebalancer, int window, double threshold, int min_points, MPI_Comm comm)
+{
+    rebalancer.window = window;
+    rebalancer.threshold = threshold;
+    rebalancer.min_points = min_points;
+    rebalancer.comm = comm;
+    rebalancer.steps = 0;
+    rebalancer.busy = 0.0;
+    rebalancer.rebalances = 0;
+    rebalancer.last_imbalance = 1.0;
+    rebalancer.times = nullptr;
+}
+
+void rebalance_record(Rebalancer &rebalancer, double seconds)
+{
+    rebalancer.steps++;
+    rebalancer.busy += seconds;
+}
+
+bool rebalance_step(Rebalancer &rebalancer, float *&local, float *&new_local,
+                    std::vector<int64_t> &counts, std::vector<int64_t> &displs)
+{
+    if (rebalancer.steps < rebalancer.window)
+    {
+        return false;
+    }
+    int num_of_processes;
+    int rank;
+    MPI_Comm_size(rebalancer.comm, &num_of_processes);
+    MPI_Comm_rank(rebalancer.comm, &rank);
+
+    // One number per rank, once per window
+    std::vector<double> busy(num_of_processes);
+    double start = phase_clock(rebalancer.times);
+    MPI_Allgather(&rebalancer.busy, 1, MPI_DOUBLE, busy.data(), 1, MPI_DOUBLE, rebalancer.comm);
+    phase_add(rebalancer.times, PHASE_REDUCE, start);
+    rebalancer.steps = 0;
+    rebalancer.busy = 0.0;
+
+    double mean = 0.0;
+    for (int p = 0; p < num_of_processes; ++p)
+    {
+        mean += busy[p] / num_of_processes;
+    }
+    rebalancer.last_imbalance = mean > 0.0 ? *std::max_element(busy.begin(), busy.end()) / mean : 1.0;
+    if (num_of_processes == 1 || rebalancer.last_imbalance <= rebalancer.threshold)
+    {
+        return false;
+    }
+
+    // Every rank sees the same times, so every rank computes the same new split
+    std::vector<double> speeds(num_of_processes);
+    for (int p = 0; p < num_of_processes; ++p)
+    {
+        speeds[p] = (double)counts[p] / std::max(busy[p], 1e-9);
+    }
+    int64_t arr_size = displs[num_of_processes - 1] + counts[num_of_processes - 1];
+    std::vector<int64_t> new_counts, new_displs;
+    // A target below min_points only fails partition_array's check; limit_moves keeps every
+    // slab at min_points or more anyway
+    partition_array(arr_size, num_of_processes, speeds, rebalancer.min_points, new_counts, new_displs);
+    if (!limit_moves(rebalancer, counts, displs, new_counts, new_displs))
+    {
+        return false;
+    }
+
+    int depth = rebalancer.min_points;
+    float *new_slab = (float *)malloc(sizeof(float) * (new_counts[rank] + 2 * depth));
+    float *new_spare = (float *)malloc(sizeof(float) * (new_counts[rank] + 2 * depth));
+    if (!new_slab || !new_spare)
+    {
+        std::cerr << "Rank " << rank << " failed to allocate memory for a rebalanced slab. Exiting." << std::endl;
+        MPI_Abort(rebalancer.comm, 1);
+    }
+    migrate(local, new_slab, depth, rank, num_of_processes, counts, displs, new_counts, new_displs, rebalancer.comm);
+    free(local);
+    free(new_local);
+    local = new_slab;
+    new_local = new_spare;
+    counts = new_counts;
+    displs = new_displs;
+    rebalancer.rebalances++;
+    return true;
+}
+
+// Moves every boundary towards its target by at most half the smaller of the two slabs next
+// to it (less min_points), so each new slab lies within its old neighbours' slabs and keeps
+// at least min_points. The boundary at global index 0 stays put. Returns false if nothing
+// moves or a slab would outgrow an int.
+bool limit_moves(const Rebalancer &rebalancer, const std::vector<int64_t> &counts, const std::vector<int64_t> &displs,
+                 std::vector<int64_t> &new_counts, std::vector<int64_t> &new_displs)
+{
+    int num_of_processes = (int)counts.size();
+    int64_t arr_size = displs[num_of_processes - 1] + counts[num_of_processes - 1];
+    bool moved = false;
+    for (int p = 1; p < num_of_processes; ++p)
+    {
+        int64_t limit = (std::min(counts[p - 1], counts[p]) - rebalancer.min_points) / 2;
+        new_displs[p] = std::max(displs[p] - limit, std::min(displs[p] + limit, new_displs[p]));
+        moved = moved || new_displs[p] != displs[p];
+    }
+    for (int p = 0; p < num_of_processes; ++p)
+    {
+        int64_t end = (p + 1 < num_of_processes) ? new_displs[p + 1] : arr_size;
+        new_counts[p] = end - new_displs[p];
+        if (new_counts[p] > INT_MAX - 2 * rebalancer.min_points)
+        {
+            return false;
+        }
+    }
+    return moved;
+}
+
+// Fills new_slab with this rank's new points: the ones it keeps are copied, the others
+// arrive from the left or right neighbour, which in turn receive the points this rank gives up
+void migrate(float *local, float *new_slab, int depth, int rank, int num_of_processes,
+             const std::vector<int64_t> &counts, const std::vector<int64_t> &displs,
+             const std::vector<int64_t> &new_counts, const std::vector<int64_t> &new_displs, MPI_Comm comm)
+{
+    int left_process = (rank + num_of_processes - 1) % num_of_processes;
+    int right_process = (rank + 1) % num_of_processes;
+    int64_t start = displs[rank];
+    int64_t end = start + counts[rank];
+    int64_t new_start = new_displs[rank];
+    int64_t new_end = new_start + new_counts[rank];
+    MPI_Request requests[4];
+    int num_requests = 0;
+
+    // Rank 0 starts at global index 0 and the last rank ends at the end of the ring, so
+    // neither migrates across the wrap-around
+    if (new_start < start)
+    {
+        MPI_Irecv(&new_slab[depth], (int)(start - new_start), MPI_FLOAT, left_process, TAG_MIGRATE_RIGHT, comm,
+                  &requests[num_requests++]);
+    }
+    if (new_end > end)
+    {
+        MPI_Irecv(&new_slab[depth + (end - new_start)], (int)(new_end - end), MPI_FLOAT, right_process,
+                  TAG_MIGRATE_LEFT, comm, &requests[num_requests++]);
+    }
+    if (new_start > start)
+    {
+        MPI_Isend(&local[depth], (int)(new_start - start), MPI_FLOAT, left_process, TAG_MIGRATE_LEFT, comm,
+                  &requests[num_requests++]);
+    }
+    if (new_end < end)
+    {
+        MPI_Isend(&local[depth + (new_end - start)], (int)(end - new_end), MPI_FLOAT, right_process,
+                  TAG_MIGRATE_RIGHT, comm, &requests[num_requests++]);
+    }
+
+    int64_t kept_start = std::max(start, new_start);
+    int64_t kept_end = std::min(end, new_end);
+    if (kept_end > kept_start)
+    {
+        std::memcpy(&new_slab[depth + (kept_start - new_start)], &local[depth + (kept_start - start)],
+                    sizeof(float) * (kept_end - kept_start));
+    }
+    MPI_Waitall(num_requests, requests, MPI_STATUSES_IGNORE);
+}
@@ -0,0 +1,38 @@
+#ifndef JACOBI_REBALANCE_H
+#define JACOBI_REBALANCE_H
+
+#include <vector>
+#include <cstdint> // For int64_t
+#include <mpi.h>
+#include "timing.h"
+
+// Moves slab boundaries between ring neighbours so that every rank spends about the same
+// time per step. Each rank adds up the time its steps spend computing (halo waits excluded,
+// since a fast rank waits for a slow one) over a window of steps. At the end of the window
+// the times are shared, and if the slowest rank is more than `threshold` times the mean, the
+// ring is re-split in proportion to every rank's measured points per second. A boundary
+// moves by at most half of the smaller slab next to it, so points only ever travel to a
+// neighbour; larger shifts take several windows.
+struct Rebalancer
+{
+    int window;       // steps between checks
+    double threshold; // largest tolerated max / mean compute time
+    int min_points;   // smallest slab allowed, the halo depth
+    MPI_Comm comm;
+    int steps;        // steps recorded in the current window
+    double busy;      // compute seconds of this rank in the current window
+    int rebalances;   // number of times slabs were moved
+    double last_imbalance;
+    PhaseTimes *times; // time of the exchange of times is added here, nullptr to not time
+};
+
+void rebalance_init(Rebalancer &rebalancer, int window, double threshold, int min_points, MPI_Comm comm);
+// Adds the compute time of one step
+void rebalance_record(Rebalancer &rebalancer, double seconds);
+// Collective. Once a window is complete, moves points between neighbours if the ranks are
+// too unbalanced. local and new_local (with min_points ghost cells per side) are then
+// reallocated for the new slab, counts and displs updated on every rank, and true returned.
+bool rebalance_step(Rebalancer &rebalancer, float *&local, float *&new_local,
+                    std::vector<int64_t> &counts, std::vector<int64_t> &displs);
+
+#endif
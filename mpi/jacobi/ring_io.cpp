@@ -0,0 +1,213 @@
+#include <iostream>
+#include <vector>
+#include <algorithm> // For std::min_element, std::max_element
+#include <climits>   // For INT_MAX
+#include "ring_io.h"
+#include "decomposition.h"
+#include "array_io.h"
+
+#define ORCHESTRATOR 0
+
+void generate_rings(int64_t arr_size, int width, int64_t first_index, int count, float *slab);
+void print_rings(int64_t arr_size, int width, const float *work);
+
+bool read_ring_size(const std::string &path, int width, MPI_Comm comm, int64_t &arr_size)
+{
+    int rank;
+    int64_t total_points;
+
+    MPI_Comm_rank(comm, &rank);
+    if (!read_array_size(path.c_str(), comm, 0, total_points) || total_points % width != 0)
+    {
+        if (rank == ORCHESTRATOR)
+        {
+            if (width > 1)
+            {
+                std::cerr << "Error: Cannot read " << width << " problems of equal size from "
+                          << path << ". Exiting." << std::endl;
+            }
+            else
+            {
+                std::cerr << "Error: Cannot read an array from " << path << ". Exiting." << std::endl;
+            }
+        }
+        return false;
+    }
+    arr_size = total_points / width;
+    return true;
+}
+
+// Every rank computes the same partition, so no rank has to be told its slab size.
+// A neighbour can only fill `depth` ghost cells if it owns that many points.
+bool partition_ring(const SolverOptions &options, int64_t arr_size, int depth, int width, MPI_Comm comm,
+                    std::vector<int64_t> &counts, std::vector<int64_t> &displs)
+{
+    int num_of_processes;
+    int rank;
+
+    MPI_Comm_size(comm, &num_of_processes);
+    MPI_Comm_rank(comm, &rank);
+    if (!options.weights.empty() && (int)options.weights.size() != num_of_processes)
+    {
+        if (rank == ORCHESTRATOR)
+        {
+            std::cerr << "Error: " << options.weights.size() << " weights given for "
+                      << num_of_processes << " processes. Exiting." << std::endl;
+        }
+        return false;
+    }
+    if (!partition_array(arr_size, num_of_processes, options.weights, depth, counts, displs))
+    {
+        if (rank == ORCHESTRATOR)
+        {
+            std::cerr << "Error: Array size " << arr_size << " leaves some of the " << num_of_processes
+                      << " processes fewer than " << depth << " points (the halo depth). Exiting." << std::endl;
+        }
+        return false;
+    }
+    // Every value of a slab, ghost cells included, must be addressable with an int
+    int64_t largest_slab = *std::max_element(counts.begin(), counts.end());
+    if ((largest_slab + 2 * depth) * width > INT_MAX)
+    {
+        if (rank == ORCHESTRATOR)
+        {
+            std::cerr << "Error: A slab of " << largest_slab << " points";
+            if (width > 1)
+            {
+                std::cerr << " of " << width << " problems";
+            }
+            std::cerr << " is too large for one process; use more processes"
+                      << (width > 1 ? " or smaller batches" : "") << ". Exiting." << std::endl;
+        }
+        return false;
+    }
+    if (rank == ORCHESTRATOR)
+    {
+        std::cout << "Points per process: " << *std::min_element(counts.begin(), counts.end())
+                  << " to " << largest_slab << std::endl;
+    }
+    return true;
+}
+
+// Every rank fills its own slab from the global indices it owns, so the whole array never
+// exists in one place and startup does not funnel through rank 0
+bool load_ring_slab(const std::string &input_path, int64_t arr_size, int width, int64_t first_index, int count,
+                    float *slab, MPI_Comm comm)
+{
+    int rank;
+
+    MPI_Comm_rank(comm, &rank);
+    if (input_path.empty())
+    {
+        generate_rings(arr_size, width, first_index, count, slab);
+        return true;
+    }
+    bool success = width > 1 ? read_array_batch(input_path.c_str(), comm, arr_size, width, first_index, count, slab)
+                             : read_array_slab(input_path.c_str(), comm, first_index, count, slab);
+    if (!success && rank == ORCHESTRATOR)
+    {
+        std::cerr << "Error: Cannot read the points of " << input_path << ". Exiting." << std::endl;
+    }
+    return success;
+}
+
+int report_ring_results(const SolverOptions &options, const char *solver, const PhaseTimes *timer,
+                        int64_t arr_size, int width, const std::vector<int64_t> &counts,
+                        const std::vector<int64_t> &displs, const float *slab, MPI_Comm comm)
+{
+    int num_of_processes;
+    int rank;
+    int exit_code = 0;
+
+    MPI_Comm_size(comm, &num_of_processes);
+    MPI_Comm_rank(comm, &rank);
+    if (timer)
+    {
+        if (!write_phase_times(*timer, options.timings_path.c_str(), solver, halo_mode_name(options.halo_mode),
+                               arr_size * width, comm))
+        {
+            if (rank == ORCHESTRATOR)
+            {
+                std::cerr << "Error: Failed to write the timings to " << options.timings_path << std::endl;
+            }
+            exit_code = 1;
+        }
+        else if (rank == ORCHESTRATOR)
+        {
+            std::cout << "Timings written to " << options.timings_path << std::endl;
+        }
+    }
+    if (!options.output_path.empty())
+    {
+        // Every rank writes its own slab straight into the file
+        const char *path = options.output_path.c_str();
+        bool success = width > 1 ? write_array_batch(path, comm, arr_size, width, displs[rank], (int)counts[rank], slab)
+                                 : write_array(path, comm, arr_size, displs[rank], (int)counts[rank], slab);
+        if (!success)
+        {
+            if (rank == ORCHESTRATOR)
+            {
+                std::cerr << "Error: Failed to write the results to " << options.output_path << std::endl;
+            }
+            exit_code = 1;
+        }
+        else if (rank == ORCHESTRATOR)
+        {
+            std::cout << "Results written to " << options.output_path << std::endl;
+        }
+    }
+    // Gather the slabs, still interleaved, to rank 0, but only for arrays small enough to be
+    // worth printing
+    else if (arr_size * width <= MAX_PRINTED_POINTS)
+    {
+        std::vector<int> recvcounts(num_of_processes), recvdispls(num_of_processes);
+        for (int p = 0; p < num_of_processes; ++p)
+        {
+            recvcounts[p] = (int)counts[p] * width;
+            recvdispls[p] = (int)displs[p] * width;
+        }
+        std::vector<float> work;
+        if (rank == ORCHESTRATOR)
+        {
+            work.resize(arr_size * width);
+        }
+        MPI_Gatherv(slab, recvcounts[rank], MPI_FLOAT, work.data(), recvcounts.data(), recvdispls.data(),
+                    MPI_FLOAT, ORCHESTRATOR, comm);
+        if (rank == ORCHESTRATOR)
+        {
+            print_rings(arr_size, width, work.data());
+        }
+    }
+    else if (rank == ORCHESTRATOR)
+    {
+        std::cout << "Final Results: not printed for more than " << MAX_PRINTED_POINTS << " points" << std::endl;
+    }
+    return exit_code;
+}
+
+// Ring b starts as the single ring's initial values rotated b points to the left, so ring 0
+// is the ring jacobi solves without --batch
+void generate_rings(int64_t arr_size, int width, int64_t first_index, int count, float *slab)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        for (int b = 0; b < width; ++b)
+        {
+            slab[(size_t)i * width + b] = (float)((first_index + i + b) % arr_size) * 20.0f;
+        }
+    }
+}
+
+// One line of values per ring
+void print_rings(int64_t arr_size, int width, const float *work)
+{
+    std::cout << "Final Results:" << std::endl;
+    for (int b = 0; b < width; ++b)
+    {
+        for (int64_t i = 0; i < arr_size; ++i)
+        {
+            std::cout << work[i * width + b] << (i == arr_size - 1 ? "" : " ");
+        }
+        std::cout << std::endl;
+    }
+}
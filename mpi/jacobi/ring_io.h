@@ -0,0 +1,32 @@
+#ifndef JACOBI_RING_IO_H
+#define JACOBI_RING_IO_H
+
+#include <vector>
+#include <string>
+#include <cstdint> // For int64_t
+#include <mpi.h>
+#include "jacobi.h"
+#include "timing.h"
+
+// Setting up and reporting a run on 1D rings, shared by the single-ring solvers and --batch.
+// A slab holds `width` interleaved rings, point i of ring b at [i * width + b], so width 1
+// is the plain single ring. All functions are collective over comm, print their errors on
+// rank 0 and return the same verdict on every rank.
+
+// Points per ring in the array file at path, which must hold width rings of equal size
+bool read_ring_size(const std::string &path, int width, MPI_Comm comm, int64_t &arr_size);
+// Checks options.weights against the process count and splits arr_size points into slabs of
+// at least depth points, each small enough that its values and 2 * depth ghost points fit an int
+bool partition_ring(const SolverOptions &options, int64_t arr_size, int depth, int width, MPI_Comm comm,
+                    std::vector<int64_t> &counts, std::vector<int64_t> &displs);
+// Fills a slab with points first_index..first_index+count-1 of every ring, read from
+// input_path or generated when it is empty
+bool load_ring_slab(const std::string &input_path, int64_t arr_size, int width, int64_t first_index, int count,
+                    float *slab, MPI_Comm comm);
+// Writes the timings if timer is set, then writes the slabs to options.output_path or
+// gathers and prints them. Returns the process exit code.
+int report_ring_results(const SolverOptions &options, const char *solver, const PhaseTimes *timer,
+                        int64_t arr_size, int width, const std::vector<int64_t> &counts,
+                        const std::vector<int64_t> &displs, const float *slab, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef JACOBI_SOR_H
+#define JACOBI_SOR_H
+
+#include <cstdint> // For int64_t
+#include "halo.h"
+
+// One red-black SOR iteration, in place, on a slab with one ghost cell per side whose
+// first point has global index first_index. Points with even global index (red) are
+// relaxed first, then the odd (black) ones, each colour after its own halo exchange.
+// Returns the largest change of any point.
+float sor_step(float *local, int size_per_process, int64_t first_index, float omega, HaloExchange &halo);
+// Over-relaxation factor that makes SOR converge fastest on a ring of num_points
+float sor_optimal_omega(int64_t num_points);
+
+#endif
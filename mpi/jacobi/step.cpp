@@ -0,0 +1,51 @@
+#include <algorithm> // For std::max
+#include "step.h"
+#include "stencil_kernels.h"
+
+// Exchanges the ghost cells of local_data and writes one Jacobi step into new_local.
+// The interior points only read values this rank owns, so they are updated while the ghost
+// cells are still travelling; the two boundary points wait for them. With a halo depth
+// above one, all ghost cells but the outermost are stepped as well, which lets the next
+// depth - 1 steps run without any exchange (see do_local_step). The interior is split between
+// the threads of the team while the main thread's messages are in flight.
+void do_one_step(float *local_data, float *new_local, float *local_error, int size_per_process, HaloExchange &halo, ThreadTeam &team)
+{
+    float max_error = 0.0f;
+    int first = halo.depth;
+    int last = halo.depth + size_per_process - 1;
+
+    halo_start(halo, local_data, size_per_process);
+    max_error = team_update_points(team, local_data, new_local, first + 1, last - 1);
+    halo_finish(halo);
+
+    max_error = std::max(max_error, update_points(local_data, new_local, first, first));
+    if (last > first)
+    {
+        max_error = std::max(max_error, update_points(local_data, new_local, last, last));
+    }
+    // Redundant updates of the neighbours' points; they don't count towards the local error
+    update_points(local_data, new_local, 1, first - 1);
+    update_points(local_data, new_local, last + 1, last + halo.depth - 1);
+
+    *local_error = max_error;
+}
+
+// Step `sweep` (2..depth) since the last exchange. Each step can only trust a region one
+// point narrower on each side than the previous one, so after `depth` steps only the
+// points this rank owns are valid and the ghost cells have to be exchanged again.
+void do_local_step(const float *local_data, float *new_local, float *local_error, int size_per_process, int depth, int sweep, ThreadTeam &team)
+{
+    int first = depth;
+    int last = depth + size_per_process - 1;
+
+    update_points(local_data, new_local, sweep, first - 1);
+    update_points(local_data, new_local, last + 1, last + depth - sweep);
+    *local_error = team_update_points(team, local_data, new_local, first, last);
+}
+
+// Writes the Jacobi update of points first..last into new_local and returns the largest change.
+// The vectorised kernel computes the change in the same pass as the update.
+float update_points(const float *local_data, float *new_local, int first, int last)
+{
+    return stencil_ring_f32(local_data, new_local, first, last);
+}
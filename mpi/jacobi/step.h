@@ -0,0 +1,17 @@
+#ifndef JACOBI_STEP_H
+#define JACOBI_STEP_H
+
+#include "halo.h"
+#include "thread_team.h"
+
+// One Jacobi step of a slab of the ring, shared by the solver and the benchmark. Slabs have
+// `depth` ghost cells on each side, so their own points start at local_data[depth].
+
+// Exchanges the ghost cells and steps the slab and all ghost cells but the outermost
+void do_one_step(float *local_data, float *new_local, float *local_error, int size_per_process, HaloExchange &halo, ThreadTeam &team);
+// Step `sweep` (2..depth) since the last exchange, without communication
+void do_local_step(const float *local_data, float *new_local, float *local_error, int size_per_process, int depth, int sweep, ThreadTeam &team);
+// Writes the Jacobi update of points first..last into new_local and returns the largest change
+float update_points(const float *local_data, float *new_local, int first, int last);
+
+#endif
@@ -0,0 +1,101 @@
+#include <algorithm>  // For std::max, std::min
+#include <functional> // For std::ref
+#include "thread_team.h"
+#include "step.h"
+
+void team_member(ThreadTeam &team, int member);
+float update_share(ThreadTeam &team, int member);
+
+bool team_start(ThreadTeam &team, int num_threads)
+{
+    team.num_threads = num_threads;
+    // A team of one never synchronises
+    team.barrier = nullptr;
+    if (num_threads > 1)
+    {
+        team.barrier = barrier_create(num_threads, nullptr);
+        if (!team.barrier)
+        {
+            return false;
+        }
+    }
+    team.local_data = nullptr;
+    team.new_local = nullptr;
+    team.first = 0;
+    team.last = -1;
+    team.stop = false;
+    team.errors.assign(num_threads, 0.0f);
+    for (int member = 1; member < num_threads; ++member)
+    {
+        team.workers.push_back(std::thread(team_member, std::ref(team), member));
+    }
+    return true;
+}
+
+float team_update_points(ThreadTeam &team, const float *local_data, float *new_local, int first, int last)
+{
+    if (team.num_threads == 1)
+    {
+        return update_points(local_data, new_local, first, last);
+    }
+    team.local_data = local_data;
+    team.new_local = new_local;
+    team.first = first;
+    team.last = last;
+
+    barrier_wait(team.barrier, 0); // hand out the job
+    team.errors[0] = update_share(team, 0);
+    barrier_wait(team.barrier, 0); // wait for every share
+
+    float max_error = 0.0f;
+    for (int member = 0; member < team.num_threads; ++member)
+    {
+        max_error = std::max(max_error, team.errors[member]);
+    }
+    return max_error;
+}
+
+void team_stop(ThreadTeam &team)
+{
+    if (!team.barrier)
+    {
+        return;
+    }
+    team.stop = true;
+    barrier_wait(team.barrier, 0);
+    for (size_t i = 0; i < team.workers.size(); ++i)
+    {
+        team.workers[i].join();
+    }
+    team.workers.clear();
+    barrier_destroy(team.barrier);
+    team.barrier = nullptr;
+}
+
+// Body of members 1..num_threads-1: one share of every job until the team is stopped
+void team_member(ThreadTeam &team, int member)
+{
+    while (true)
+    {
+        barrier_wait(team.barrier, member);
+        if (team.stop)
+        {
+            return;
+        }
+        team.errors[member] = update_share(team, member);
+        barrier_wait(team.barrier, member);
+    }
+}
+
+// Contiguous shares keep every thread streaming through its own part of the slab
+float update_share(ThreadTeam &team, int member)
+{
+    long points = (long)team.last - team.first + 1;
+    if (points <= 0)
+    {
+        return 0.0f;
+    }
+    int first = team.first + (int)(points * member / team.num_threads);
+    int last = team.first + (int)(points * (member + 1) / team.num_threads) - 1;
+    return update_points(team.local_data, team.new_local, first, std::min(last, team.last));
+}
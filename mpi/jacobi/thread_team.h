@@ -0,0 +1,35 @@
+#ifndef JACOBI_THREAD_TEAM_H
+#define JACOBI_THREAD_TEAM_H
+
+#include <vector>
+#include <thread>
+#include "barrier.h"
+
+// A fixed team of threads that splits the update of one slab between them. The calling
+// thread is member 0 and the only one that talks to MPI (MPI_THREAD_FUNNELED), so a rank
+// still exchanges one halo per step however many threads it runs.
+struct ThreadTeam
+{
+    int num_threads;
+    std::vector<std::thread> workers; // members 1..num_threads-1
+    struct Barrier *barrier;          // spin-then-futex barrier of common/barrier.c, which also
+                                      // orders the job fields below
+
+    // The current job, written by member 0 between two barriers
+    const float *local_data;
+    float *new_local;
+    int first;
+    int last;
+    bool stop;
+    std::vector<float> errors; // largest change found by every member
+};
+
+// Synchronises with the barrier variant named by $BARRIER (see common/barrier.h); returns
+// false, without starting any thread, if that variant is unknown
+bool team_start(ThreadTeam &team, int num_threads);
+// Jacobi update of points first..last, split evenly between the members; returns the
+// largest change. Must be called by the thread that started the team.
+float team_update_points(ThreadTeam &team, const float *local_data, float *new_local, int first, int last);
+void team_stop(ThreadTeam &team);
+
+#endif
@@ -0,0 +1,112 @@
+#include <fstream>
+#include <iomanip>   // For std::setprecision
+#include <vector>
+#include <algorithm> // For std::min, std::max
+#include "timing.h"
+
+// Per-rank values gathered onto rank 0, in this order
+#define NUM_FIELDS 6
+const char *field_names[NUM_FIELDS] = {"total", "compute", "halo", "reduce", "checkpoint", "bytes_sent"};
+
+void write_summary(std::ofstream &out, const std::vector<double> &all, int field, int num_processes);
+
+void phase_times_init(PhaseTimes &times)
+{
+    for (int phase = 0; phase < NUM_PHASES; ++phase)
+    {
+        times.seconds[phase] = 0.0;
+    }
+    times.solve_seconds = 0.0;
+    times.bytes_sent = 0;
+    times.iterations = 0;
+}
+
+double phase_clock(const PhaseTimes *times)
+{
+    return times ? MPI_Wtime() : 0.0;
+}
+
+void phase_add(PhaseTimes *times, Phase phase, double start)
+{
+    if (times)
+    {
+        times->seconds[phase] += MPI_Wtime() - start;
+    }
+}
+
+bool write_phase_times(const PhaseTimes &times, const char *path, const char *solver, const char *halo_mode,
+                       int64_t num_points, MPI_Comm comm)
+{
+    int rank, num_processes;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &num_processes);
+
+    double compute = times.solve_seconds;
+    for (int phase = 0; phase < NUM_PHASES; ++phase)
+    {
+        compute -= times.seconds[phase];
+    }
+    double mine[NUM_FIELDS] = {times.solve_seconds, compute, times.seconds[PHASE_HALO],
+                               times.seconds[PHASE_REDUCE], times.seconds[PHASE_CHECKPOINT],
+                               (double)times.bytes_sent};
+    std::vector<double> all;
+    if (rank == 0)
+    {
+        all.resize((size_t)NUM_FIELDS * num_processes);
+    }
+    MPI_Gather(mine, NUM_FIELDS, MPI_DOUBLE, all.data(), NUM_FIELDS, MPI_DOUBLE, 0, comm);
+
+    int ok = 1;
+    if (rank == 0)
+    {
+        std::ofstream out(path);
+        out << std::setprecision(12);
+        out << "{\n";
+        out << "  \"solver\": \"" << solver << "\",\n";
+        out << "  \"halo\": \"" << halo_mode << "\",\n";
+        out << "  \"points\": " << num_points << ",\n";
+        out << "  \"processes\": " << num_processes << ",\n";
+        out << "  \"iterations\": " << times.iterations << ",\n";
+        out << "  \"summary\": {\n";
+        for (int field = 0; field < NUM_FIELDS; ++field)
+        {
+            write_summary(out, all, field, num_processes);
+            out << (field == NUM_FIELDS - 1 ? "\n" : ",\n");
+        }
+        out << "  },\n";
+        out << "  \"ranks\": [\n";
+        for (int p = 0; p < num_processes; ++p)
+        {
+            out << "    {\"rank\": " << p;
+            for (int field = 0; field < NUM_FIELDS; ++field)
+            {
+                out << ", \"" << field_names[field] << "\": " << all[(size_t)p * NUM_FIELDS + field];
+            }
+            out << (p == num_processes - 1 ? "}\n" : "},\n");
+        }
+        out << "  ]\n";
+        out << "}\n";
+        ok = out.good() ? 1 : 0;
+    }
+    MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+    return ok == 1;
+}
+
+// One "name": {min, max, mean, imbalance} entry. An imbalance of 1 means every rank took the
+// same time; the slowest rank holds the others back by (imbalance - 1) of the mean.
+void write_summary(std::ofstream &out, const std::vector<double> &all, int field, int num_processes)
+{
+    double lowest = all[field];
+    double highest = all[field];
+    double sum = 0.0;
+    for (int p = 0; p < num_processes; ++p)
+    {
+        double value = all[(size_t)p * NUM_FIELDS + field];
+        lowest = std::min(lowest, value);
+        highest = std::max(highest, value);
+        sum += value;
+    }
+    double mean = sum / num_processes;
+    out << "    \"" << field_names[field] << "\": {\"min\": " << lowest << ", \"max\": " << highest
+        << ", \"mean\": " << mean << ", \"imbalance\": " << (mean > 0.0 ? highest / mean : 1.0) << "}";
+}
@@ -0,0 +1,37 @@
+#ifndef JACOBI_TIMING_H
+#define JACOBI_TIMING_H
+
+#include <cstdint> // For int64_t
+#include <mpi.h>
+
+// Phases timed where their MPI calls are made. Whatever else the solve spends its time on
+// is reported as compute.
+enum Phase
+{
+    PHASE_HALO,       // halo_start and halo_finish, including any wait for the neighbours
+    PHASE_REDUCE,     // global error reductions and the solvers' other collectives (dot products,
+                      // the multigrid coarse-level gather, the rebalancer's exchange of times)
+    PHASE_CHECKPOINT, // starting and completing checkpoint writes
+    NUM_PHASES
+};
+
+// Wall time and traffic of one rank. Modules hold a pointer to it that is nullptr when
+// timing is off, so an untimed run makes no MPI_Wtime calls.
+struct PhaseTimes
+{
+    double seconds[NUM_PHASES];
+    double solve_seconds;
+    int64_t bytes_sent;
+    int iterations;
+};
+
+void phase_times_init(PhaseTimes &times);
+// Start of a timed region: MPI_Wtime() when timing, 0 otherwise
+double phase_clock(const PhaseTimes *times);
+void phase_add(PhaseTimes *times, Phase phase, double start);
+// Gathers every rank's times onto rank 0, which writes them to path as JSON together with
+// their min/max/mean and imbalance (max / mean). Collective; returns the same on every rank.
+bool write_phase_times(const PhaseTimes &times, const char *path, const char *solver, const char *halo_mode,
+                       int64_t num_points, MPI_Comm comm);
+
+#endif
@@ -6,6 +6,18 @@
  * 5. This process is then repeated but grid_1 and grid_2 is swapped. (so grid_2 is now updated)
  * 6. But before grid_2 is updated, a barrier is used to synchronize all threads to have finished updating grid_1, 
  * 7.
+ *
+ * The sweeps call the SIMD kernels in common/stencil_kernels.c, and the workers meet at the
+ * barriers in common/barrier.c (BARRIER=sense|dissemination|tournament|condvar picks one):
+ *   gcc -O2 -pthread -I../../common jacobi.c ../../common/stencil_kernels.c ../../common/barrier.c -o jacobi
+ *   ./jacobi <gridSize> <numWorkers> <numIters> [tileCols [tileRows [timeBlock]]]
+ *
+ * Sweeps go over tiles of tileCols x tileRows points, so the three rows a tile reads stay in
+ * cache until every neighbour has used them. tileCols 0 (the default) auto-tunes the width,
+ * tileRows 0 (the default) makes a tile as tall as the worker's strip.
+ *
+ * A timeBlock of T > 0 runs T half-steps at a time instead (see TemporalBlock), with two
+ * barriers per block rather than one per half-step; the tile sizes are then not used.
  */
 
 #define _REENTRANT
@@ -14,21 +26,41 @@
 #include <stdlib.h>
 #include <sys/times.h>
 #include <limits.h>
+#include <time.h>
+#include "stencil_kernels.h"
+#include "barrier.h"
 #define SHARED 1
-#define MAXGRID 258   /* maximum grid size, including boundaries */
 #define MAXWORKERS 4  /* maximum number of worker threads --> follows bag of task paradigm */
+#define CACHELINE 64  /* bytes; grid rows start on a cache line */
+#define LINEDOUBLES (CACHELINE / (int) sizeof(double))
+#define MAXPRINTED 1024 /* larger grids are not written to the results file */
+#define NUMCANDIDATES 8 /* tile widths tried by the auto-tuner: 64, 128, ... 4096, full rows */
+#define TUNEROWS 256    /* rows of each strip swept per candidate */
+#define TUNESWEEPS 3    /* sweeps timed per candidate */
+#define POINTBYTES 16   /* memory traffic of one point update: one double read, one written */
 
 void *Worker(void *);
+double Sweep(double **src, double **dst, int first, int last, int cols, int rows);
+int TuneTileCols(long myid, int first, int last);
+int CandidateCols(int c);
+double TemporalBlock(long myid, int first, int last, int firstStep, int steps);
+double Seconds();
+double **AllocateGrid(double **block);
 void InitializeGrids();
-void barrier_init();
-void barrier();
 
 struct tms buffer;        /* used for timing */
 clock_t start, finish;
 
-int gridSize, numWorkers, numIters, stripSize;
+int gridSize, numWorkers, numIters;
+int tileCols, tileRows;   /* 0 until chosen */
+int timeBlock;            /* half-steps per temporal block, 0 for one sweep at a time */
+double tuneTimes[MAXWORKERS][NUMCANDIDATES]; /* each worker's time per candidate width */
+double sweepStart, sweepFinish; /* wall time of the iterations, in seconds */
+long rowPitch;            /* doubles from one row of a grid to the next */
 double maxDiff[MAXWORKERS];
-double grid1[MAXGRID][MAXGRID], grid2[MAXGRID][MAXGRID];
+double **grid1, **grid2;  /* row pointers, so grid1[i][j] is row i, column j */
+double *block1, *block2;  /* the memory of each grid */
+struct Barrier *workers;  /* between sweeps; the variant is chosen by $BARRIER */
 
 
 /* main() -- read command line, initialize grids, and create threads
@@ -47,12 +79,50 @@ int main(int argc, char *argv[]) {
   pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
 
   /* read command line and initialize grids */
+  if (argc < 4) {
+    printf("usage: %s <gridSize> <numWorkers> <numIters> [tileCols [tileRows [timeBlock]]]\n", argv[0]);
+    return 1;
+  }
   gridSize = atoi(argv[1]);
   numWorkers = atoi(argv[2]);
   numIters = atoi(argv[3]);
-  stripSize = gridSize/numWorkers;
+  tileCols = argc > 4 ? atoi(argv[4]) : 0;
+  tileRows = argc > 5 ? atoi(argv[5]) : 0;
+  timeBlock = argc > 6 ? atoi(argv[6]) : 0;
+  if (gridSize < 1 || numWorkers < 1 || numWorkers > MAXWORKERS || numWorkers > gridSize) {
+    printf("need gridSize >= numWorkers and 1 to %d workers\n", MAXWORKERS);
+    return 1;
+  }
+  if (tileCols < 0 || tileRows < 0 || timeBlock < 0) {
+    printf("tile sizes must be positive, or 0 for the default\n");
+    return 1;
+  }
+  /* a block ends on the grid it started from, and the triangles between strips (which
+     widen by two rows per half-step) must not reach the next strip boundary */
+  if (timeBlock > gridSize / numWorkers / 2)
+    timeBlock = gridSize / numWorkers / 2;
+  timeBlock -= timeBlock % 2;
 
-  barrier_init(); // create the barriers
+  /* a row is the interior plus a boundary point on each side, shifted to align the interior
+     (see AllocateGrid) and rounded up to whole cache lines. An odd number of lines keeps
+     rows a power of two apart from mapping to the same cache sets, which would make the
+     rows above and below evict each other. */
+  rowPitch = (gridSize + 2 + (LINEDOUBLES - 1) + (LINEDOUBLES - 1)) / LINEDOUBLES;
+  if (rowPitch % 2 == 0)
+    rowPitch++;
+  rowPitch *= LINEDOUBLES;
+  grid1 = AllocateGrid(&block1);
+  grid2 = AllocateGrid(&block2);
+  if (grid1 == NULL || grid2 == NULL) {
+    printf("cannot allocate two %d x %d grids\n", gridSize + 2, gridSize + 2);
+    return 1;
+  }
+
+  workers = barrier_create(numWorkers, NULL);
+  if (workers == NULL) {
+    printf("unknown barrier %s; use sense, dissemination, tournament or condvar\n", getenv("BARRIER"));
+    return 1;
+  }
   InitializeGrids();
 
   start = times(&buffer);
@@ -69,15 +139,58 @@ int main(int argc, char *argv[]) {
       maxdiff = maxDiff[i];
   printf("number of iterations:  %d\nmaximum difference:  %e\n",
           numIters, maxdiff);
+  printf("stencil kernels:  %s\n", stencil_isa());
+  printf("barrier:  %s\n", barrier_variant(workers));
+  if (timeBlock > 0) {
+    printf("temporal blocks:  %d half-steps\n", timeBlock);
+  } else {
+    printf("tile:  %d columns x ", tileCols);
+    if (tileRows > 0)
+      printf("%d rows\n", tileRows);
+    else
+      printf("strip\n");
+  }
+  if (numIters > 0 && sweepFinish > sweepStart)
+    printf("sweep bandwidth:  %.2f GB/s\n", 2.0 * numIters * gridSize * (double) gridSize * POINTBYTES
+                                              / (sweepFinish - sweepStart) / 1e9);
   printf("start:  %ld   finish:  %ld\n", start, finish);
   printf("elapsed time:  %ld\n", finish-start);
-  results = fopen("results", "w");
-  for (i = 1; i <= gridSize; i++) {
-    for (j = 1; j <= gridSize; j++) {
-      fprintf(results, "%f ", grid2[i][j]);
+  if (gridSize <= MAXPRINTED) {
+    results = fopen("results", "w");
+    for (i = 1; i <= gridSize; i++) {
+      for (j = 1; j <= gridSize; j++) {
+        fprintf(results, "%f ", grid2[i][j]);
+      }
+      fprintf(results, "\n");
     }
-    fprintf(results, "\n");
+    fclose(results);
   }
+  free(grid1);
+  free(grid2);
+  free(block1);
+  free(block2);
+  barrier_destroy(workers);
+  return 0;
+}
+
+/* Allocates a (gridSize+2) x (gridSize+2) grid of rowPitch-spaced rows in one 64-byte
+   aligned block, returned through block. Each row is offset so that its first interior
+   point, not the boundary point before it, starts a cache line, which is what the stencil
+   kernels load and store in whole vectors. Returns the row pointers, or NULL. */
+double **AllocateGrid(double **block) {
+  double **rows;
+  long i;
+  size_t rowCount = (size_t) gridSize + 2;
+  if (posix_memalign((void **) block, CACHELINE, rowCount * rowPitch * sizeof(double)) != 0)
+    return NULL;
+  rows = malloc(rowCount * sizeof(double *));
+  if (rows == NULL) {
+    free(*block);
+    return NULL;
+  }
+  for (i = 0; i < (long) rowCount; i++)
+    rows[i] = *block + i * rowPitch + LINEDOUBLES - 1;
+  return rows;
 }
 
 
@@ -87,46 +200,158 @@ int main(int argc, char *argv[]) {
 
 void *Worker(void *arg) {
   long myid = (long) arg;
-  double maxdiff, temp;
-  int i, j, iters;
-  int first, last;
+  double maxdiff;
+  int iters, step, steps;
+  int first, last, cols, rows;
 
   printf("worker %ld (pthread id %ld) has started\n", myid, pthread_self());
 
-  /* determine first and last rows of my strip of the grids */
-  first = myid*stripSize + 1;
-  last = first + stripSize - 1;
+  /* determine first and last rows of my strip of the grids; strips differ by at most a
+     row when numWorkers does not divide gridSize */
+  first = myid*gridSize/numWorkers + 1;
+  last = (myid+1)*gridSize/numWorkers;
+
+  /* every worker reaches the same verdict, so only worker 0 records it, once the others
+     have read tileCols */
+  cols = tileCols;
+  if (cols == 0)
+    cols = numIters > 0 && timeBlock == 0 ? TuneTileCols(myid, first, last) : gridSize;
+  rows = tileRows > 0 ? tileRows : last - first + 1;
 
-  for (iters = 1; iters <= numIters; iters++) {
+  barrier_wait(workers, myid);
+  if (myid == 0) {
+    tileCols = cols;
+    sweepStart = Seconds();
+  }
+  maxdiff = 0.0;
+  /* temporal blocks: half-step s goes from grid1 to grid2 when odd, and back when even */
+  for (step = 0; timeBlock > 0 && step < 2 * numIters; step += timeBlock) {
+    steps = 2 * numIters - step < timeBlock ? 2 * numIters - step : timeBlock;
+    maxdiff = TemporalBlock(myid, first, last, step + 1, steps);
+  }
+  for (iters = 1; timeBlock == 0 && iters <= numIters; iters++) {
     /* update my points */
-    for (i = first; i <= last; i++) {
-      for (j = 1; j <= gridSize; j++) {
-        grid2[i][j] = (grid1[i-1][j] + grid1[i+1][j] + 
-                       grid1[i][j-1] + grid1[i][j+1]) * 0.25;
+    Sweep(grid1, grid2, first, last, cols, rows);
+    barrier_wait(workers, myid);
+    /* update my points again. The kernel returns how far the points moved, so after the
+       last iteration maxdiff is the maximum difference between the grids without another pass */
+    maxdiff = Sweep(grid2, grid1, first, last, cols, rows);
+    barrier_wait(workers, myid);
+  }
+  if (myid == 0)
+    sweepFinish = Seconds();
+  maxDiff[myid] = maxdiff; // sets the global variable maxDiff
+}
+
+/* Updates rows first..last of dst from src in tiles of cols x rows points, row by row within
+   a tile, and returns the largest change. Rows i-1 and i of a tile are still cached when row
+   i+1 reads them as long as three tile rows fit in cache, however wide the grid is. */
+double Sweep(double **src, double **dst, int first, int last, int cols, int rows) {
+  double maxdiff = 0.0, temp;
+  int i, ii, jj, rowEnd, colEnd;
+  for (ii = first; ii <= last; ii += rows) {
+    rowEnd = ii + rows - 1 < last ? ii + rows - 1 : last;
+    for (jj = 1; jj <= gridSize; jj += cols) {
+      colEnd = jj + cols - 1 < gridSize ? jj + cols - 1 : gridSize;
+      for (i = ii; i <= rowEnd; i++) {
+        temp = stencil_row5_f64(src[i-1], src[i], src[i+1], dst[i], jj, colEnd);
+        if (maxdiff < temp)
+          maxdiff = temp;
       }
     }
-    barrier();
-    /* update my points again */
-    for (i = first; i <= last; i++) {
-      for (j = 1; j <= gridSize; j++) {
-        grid1[i][j] = (grid2[i-1][j] + grid2[i+1][j] +
-               grid2[i][j-1] + grid2[i][j+1]) * 0.25;
-      }
+  }
+  return maxdiff;
+}
+
+/* Times a few sweeps of the first TUNEROWS rows of the strip for every candidate width, all
+   workers at once so that they compete for memory bandwidth as they will later, and returns
+   the width whose slowest worker was fastest. An untimed sweep first faults the pages in.
+   The sweeps write grid2 from grid1, which the first iteration overwrites anyway. */
+int TuneTileCols(long myid, int first, int last) {
+  int c, k, w, best = 0;
+  int tuneLast = last - first + 1 > TUNEROWS ? first + TUNEROWS - 1 : last;
+  double begin, slowest, bestTime = 0.0;
+  Sweep(grid1, grid2, first, tuneLast, gridSize, tuneLast - first + 1);
+  for (c = 0; c < NUMCANDIDATES; c++) {
+    barrier_wait(workers, myid);
+    begin = Seconds();
+    for (k = 0; k < TUNESWEEPS; k++)
+      Sweep(grid1, grid2, first, tuneLast, CandidateCols(c), tuneLast - first + 1);
+    tuneTimes[myid][c] = Seconds() - begin;
+  }
+  barrier_wait(workers, myid);
+  for (c = 0; c < NUMCANDIDATES; c++) {
+    slowest = 0.0;
+    for (w = 0; w < numWorkers; w++)
+      if (slowest < tuneTimes[w][c])
+        slowest = tuneTimes[w][c];
+    if (c == 0 || slowest < bestTime) {
+      best = c;
+      bestTime = slowest;
     }
-    barrier();
   }
-  /* compute the maximum difference in my strip and set global variable */
-  maxdiff = 0.0;
-  for (i = first; i <= last; i++) {
-    for (j = 1; j <= gridSize; j++) {
-      temp = grid1[i][j]-grid2[i][j];
-      if (temp < 0)
-        temp = -temp;
-      if (maxdiff < temp)
+  return CandidateCols(best);
+}
+
+/* Runs half-steps firstStep .. firstStep+steps-1 (steps even) on this worker's strip in two
+   phases, so that the whole block costs two barriers.
+
+   Phase 1: the strip is advanced as a trapezoid that loses a row at each end per half-step,
+   since the rows next to it are only valid at the half-step it started from. The top and
+   bottom of the grid are fixed and do not shrink. The trapezoid is swept as a wavefront:
+   for each row entering it, every half-step advances one row, one row behind the previous
+   half-step, so only about steps + 2 rows of each grid are in use at any time and they
+   stay cached across all the half-steps.
+
+   Phase 2, after a barrier: the triangle between this strip and the one above, which widens
+   by two rows per half-step, is filled in from the two trapezoids one half-step at a time.
+
+   Each row's half-step s reads half-step s-1 of three rows, which the order above guarantees
+   has been written and not yet overwritten by half-step s+1 in the same grid. Returns the
+   largest change of the last half-step over the rows this worker wrote in it. */
+double TemporalBlock(long myid, int first, int last, int firstStep, int steps) {
+  double **grids[2] = {grid1, grid2}; /* half-step s writes grids[s % 2] */
+  double maxdiff = 0.0, temp;
+  int s, k, p, r, lo, hi;
+  int lastStep = firstStep + steps - 1;
+  for (p = first; p <= last + steps - 1; p++) {
+    for (k = 0; k < steps; k++) {
+      s = firstStep + k;
+      r = p - k;
+      lo = first == 1 ? 1 : first + k;
+      hi = last == gridSize ? gridSize : last - k;
+      if (r < lo || r > hi)
+        continue;
+      temp = stencil_row5_f64(grids[(s-1) % 2][r-1], grids[(s-1) % 2][r], grids[(s-1) % 2][r+1],
+                              grids[s % 2][r], 1, gridSize);
+      if (s == lastStep && maxdiff < temp)
         maxdiff = temp;
     }
   }
-  maxDiff[myid] = maxdiff; // sets the global variable maxDiff
+  barrier_wait(workers, myid);
+  for (k = 1; myid > 0 && k < steps; k++) {
+    s = firstStep + k;
+    for (r = first - k; r <= first + k - 1; r++) {
+      temp = stencil_row5_f64(grids[(s-1) % 2][r-1], grids[(s-1) % 2][r], grids[(s-1) % 2][r+1],
+                              grids[s % 2][r], 1, gridSize);
+      if (s == lastStep && maxdiff < temp)
+        maxdiff = temp;
+    }
+  }
+  barrier_wait(workers, myid);
+  return maxdiff;
+}
+
+/* Doubling widths from 64 columns, the last candidate being whole rows */
+int CandidateCols(int c) {
+  int cols = c < NUMCANDIDATES - 1 ? 64 << c : gridSize;
+  return cols < gridSize ? cols : gridSize;
+}
+
+double Seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
 }
 
 void InitializeGrids() {
@@ -152,48 +377,3 @@ void InitializeGrids() {
   }
 }
 
-
-struct BarrierData {
-  pthread_mutex_t barrier_mutex;
-  pthread_cond_t barrier_cond;
-  int nthread; // volatile not required since mutex acts as memory barrier
-  int round; // volatile not required since mutex acts as memory barrier
-} bstate;
-
-void barrier_init() {
-  pthread_mutex_init(&bstate.barrier_mutex, NULL);
-  pthread_cond_init(&bstate.barrier_cond, NULL);
-  bstate.nthread = 0;
-}
-
-void barrier() {
-    // Lock the mutex to ensure only one thread can enter the critical section at a time
-    pthread_mutex_lock(&bstate.barrier_mutex);
-
-    // Increment the number of threads that have reached the barrier
-    bstate.nthread++;
-
-    // Check if all threads have reached the barrier
-    if (bstate.nthread == numWorkers) {
-        // If all threads have arrived, move to the next round
-        bstate.round++;
-
-        // Reset the thread count for the next use of the barrier
-        bstate.nthread = 0;
-
-        // Wake up all threads waiting on the condition variable
-        pthread_cond_broadcast(&bstate.barrier_cond);
-    } else {
-        // If not all threads have arrived, save the current round number
-        int lround = bstate.round;
-
-        // Wait for the condition variable to be signaled
-        // The loop ensures that threads are not woken up spuriously (spurious wakeups)
-        do {
-            pthread_cond_wait(&bstate.barrier_cond, &bstate.barrier_mutex); // the mutex lock here is implicitly released while waiting.
-        } while (lround == bstate.round); // Spinlock-like behavior: wait until the round changes
-    }
-
-    // Unlock the mutex to allow other threads to proceed
-    pthread_mutex_unlock(&bstate.barrier_mutex);
-}
@@ -26,12 +26,18 @@
  * 
  * # Phase 3
  * In this phase, thread 0 has no more work left to do, while other threads will need to recompute their chunk by referencing the last value of the previous chunk. Therefore, there is no more synchronization required in this phase.
+ * 
+ * # Note
+ * The monitor now lives in common/barrier.c as the condvar variant of barrier_wait, alongside
+ * the sense, dissemination and tournament variants; the environment variable BARRIER picks one:
+ *   gcc -O2 -pthread -I../../common s2768394.c ../../common/barrier.c -o s2768394
  */
 
 #include <pthread.h>
 #include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "barrier.h"
 
 #define SHOWDATA 1
 #define NITEMS 10000
@@ -45,19 +51,12 @@ typedef struct worker_params {
   int *data; // whole array
 } worker_params;
 
-struct BarrierData {
-  pthread_mutex_t barrier_mutex;
-  pthread_cond_t barrier_cond;
-  int nthread; // volatile not required as mutex acts as memory barrier
-  int round;   // volatile not required as mutex acts as memory barrier
-} bstate;
+struct Barrier *workers; // between the phases
 
-void barrier_init();
 void *thread(void *arg);
 void phase_1(worker_params *worker_info);
 void phase_2(worker_params *worker_info);
 void phase_3(worker_params *worker_info);
-void barrier();
 
 // Print a helpful message followed by the contents of an array
 // Controlled by the value of SHOWDATA, which should be defined
@@ -101,8 +100,12 @@ void parallelprefixsum(int *data, int n) {
   int chunk_slice = NITEMS / NTHREADS;
   int chunk_first_index = 0;
 
-  // initialize barrier mutex and condition variables.
-  barrier_init();
+  // create the barrier; the variant comes from $BARRIER.
+  workers = barrier_create(NTHREADS, NULL);
+  if (workers == NULL) {
+    printf("Unknown barrier %s; use sense, dissemination, tournament or condvar\n", getenv("BARRIER"));
+    exit(EXIT_FAILURE);
+  }
 
   for (int id = 0; id < NTHREADS; id++) {
     // initialize worker params
@@ -125,6 +128,7 @@ void parallelprefixsum(int *data, int n) {
   for (int id = 0; id < NTHREADS; id++) {
     pthread_join(threads[id], NULL);
   }
+  barrier_destroy(workers);
 }
 
 void *thread(void *arg) {
@@ -132,13 +136,13 @@ void *thread(void *arg) {
 
   phase_1(worker_info);
 
-  barrier();
+  barrier_wait(workers, worker_info->worker_id);
 
   if (worker_info->worker_id == 0) {
     phase_2(worker_info);
   }
 
-  barrier();
+  barrier_wait(workers, worker_info->worker_id);
 
   if (worker_info->worker_id != 0) {
     phase_3(worker_info);
@@ -179,38 +183,6 @@ void phase_3(worker_params *worker_info) {
   }
 }
 
-void barrier_init() {
-  pthread_mutex_init(&bstate.barrier_mutex, NULL);
-  pthread_cond_init(&bstate.barrier_cond, NULL);
-  bstate.nthread = 0;
-}
-
-void barrier() {
-  // only 1 thread can come into the barrier at a time.
-  // if not they will be blocked here.
-  pthread_mutex_lock(&bstate.barrier_mutex);
-  bstate.nthread += 1;
-
-  // check if this is the last thread.
-  // if it is, all threads have arrived.
-  if (bstate.nthread == NTHREADS) {
-    bstate.round += 1;
-    bstate.nthread = 0;
-    pthread_cond_broadcast(
-        &bstate.barrier_cond); // wakes up all threads waiting.
-  } else {
-    // this is not the last thread.
-    // thread should join the condition queue.
-    int current_round = bstate.round;
-
-    do {
-      pthread_cond_wait(&bstate.barrier_cond, &bstate.barrier_mutex);
-    } while (bstate.round == current_round); // prevents spurious wakeups
-  }
-
-  pthread_mutex_unlock(&bstate.barrier_mutex);
-}
-
 int main(int argc, char *argv[]) {
 
   int *arr1, *arr2, i;